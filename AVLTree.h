@@ -11,9 +11,10 @@ private:
         Node* left;
         Node* right;
         int height;
+        int size;
 
         explicit Node(T val)
-            : data(val), left(nullptr), right(nullptr), height(1) {}
+            : data(val), left(nullptr), right(nullptr), height(1), size(1) {}
     };
 
     Node* root;
@@ -26,6 +27,19 @@ private:
         }
     }
 
+    int get_size(Node* node) {
+        if (node) {
+            return node->size;
+        } else {
+            return 0;
+        }
+    }
+
+    void update(Node* node) {
+        node->height = max(get_height(node->left), get_height(node->right)) + 1;
+        node->size = get_size(node->left) + get_size(node->right) + 1;
+    }
+
     int get_balance(Node* node) {
         if (node) {
             return get_height(node->left) - get_height(node->right);
@@ -49,8 +63,8 @@ private:
         x->right = y;
         y->left = T2;
 
-        y->height = max(get_height(y->left), get_height(y->right)) + 1;
-        x->height = max(get_height(x->left), get_height(x->right)) + 1;
+        update(y);
+        update(x);
 
         return x;
     }
@@ -62,8 +76,8 @@ private:
         y->left = x;
         x->right = T2;
 
-        x->height = max(get_height(x->left), get_height(x->right)) + 1;
-        y->height = max(get_height(y->left), get_height(y->right)) + 1;
+        update(x);
+        update(y);
 
         return y;
     }
@@ -81,8 +95,7 @@ private:
             return node;
         }
 
-        node->height = 1 + max(get_height(node->left),
-                                    get_height(node->right));
+        update(node);
 
         int balance = get_balance(node);
 
@@ -107,6 +120,63 @@ private:
         return node;
     }
 
+    Node* rebalance(Node* node) {
+        update(node);
+        int balance = get_balance(node);
+
+        if (balance > 1) {
+            if (get_balance(node->left) < 0) {
+                node->left = left_rotate(node->left);
+            }
+            return right_rotate(node);
+        }
+
+        if (balance < -1) {
+            if (get_balance(node->right) > 0) {
+                node->right = right_rotate(node->right);
+            }
+            return left_rotate(node);
+        }
+
+        return node;
+    }
+
+    Node* remove_min(Node* node, Node*& min_node) {
+        if (!node->left) {
+            min_node = node;
+            return node->right;
+        }
+        node->left = remove_min(node->left, min_node);
+        return rebalance(node);
+    }
+
+    Node* remove_node(Node* node, T& value, bool& removed) {
+        if (!node) {
+            return nullptr;
+        }
+
+        if (value < node->data) {
+            node->left = remove_node(node->left, value, removed);
+        } else if (value > node->data) {
+            node->right = remove_node(node->right, value, removed);
+        } else {
+            removed = true;
+            Node* left = node->left;
+            Node* right = node->right;
+            delete node;
+            if (!right) {
+                return left;
+            }
+            Node* min_node = nullptr;
+            Node* rest = remove_min(right, min_node);
+            min_node->left = left;
+            min_node->right = rest;
+            return rebalance(min_node);
+        }
+
+        return rebalance(node);
+    }
+
     Node* copy_tree(Node* node) {
         if (!node) {
             return nullptr;
@@ -115,6 +185,7 @@ private:
         new_node->left = copy_tree(node->left);
         new_node->right = copy_tree(node->right);
         new_node->height = node->height;
+        new_node->size = node->size;
         return new_node;
     }
 
@@ -139,7 +210,111 @@ private:
         return search_node(node->right, value);
     }
 
+    template<typename K, typename Visitor>
+    void visit_range_node(Node* node, K& low, K& high, Visitor& visit) {
+        if (!node) {
+            return;
+        }
+        if (node->data < low) {
+            visit_range_node(node->right, low, high, visit);
+            return;
+        }
+        if (high < node->data) {
+            visit_range_node(node->left, low, high, visit);
+            return;
+        }
+        visit_range_node(node->left, low, high, visit);
+        visit(node->data);
+        visit_range_node(node->right, low, high, visit);
+    }
+
 public:
+    class Iterator {
+    private:
+        static const int MAX_DEPTH = 64;
+        Node* stack_[MAX_DEPTH];
+        int top_;
+
+        void push_left(Node* node) {
+            while (node) {
+                stack_[top_++] = node;
+                node = node->left;
+            }
+        }
+
+        friend class AVLTree;
+
+    public:
+        Iterator() : top_(0) {}
+
+        bool valid() {
+            return top_ > 0;
+        }
+
+        T& operator*() {
+            if (top_ == 0) {
+                throw "Iterator out of range";
+            }
+            return stack_[top_ - 1]->data;
+        }
+
+        T* operator->() {
+            return &(**this);
+        }
+
+        Iterator& operator++() {
+            if (top_ == 0) {
+                return *this;
+            }
+            Node* node = stack_[--top_];
+            push_left(node->right);
+            return *this;
+        }
+    };
+
+    class ReverseIterator {
+    private:
+        static const int MAX_DEPTH = 64;
+        Node* stack_[MAX_DEPTH];
+        int top_;
+
+        void push_right(Node* node) {
+            while (node) {
+                stack_[top_++] = node;
+                node = node->right;
+            }
+        }
+
+        friend class AVLTree;
+
+    public:
+        ReverseIterator() : top_(0) {}
+
+        bool valid() {
+            return top_ > 0;
+        }
+
+        T& operator*() {
+            if (top_ == 0) {
+                throw "Iterator out of range";
+            }
+            return stack_[top_ - 1]->data;
+        }
+
+        T* operator->() {
+            return &(**this);
+        }
+
+        ReverseIterator& operator++() {
+            if (top_ == 0) {
+                return *this;
+            }
+            Node* node = stack_[--top_];
+            push_right(node->left);
+            return *this;
+        }
+    };
+
     explicit AVLTree() : root(nullptr) {}
 
     AVLTree(const AVLTree& other) : root(nullptr) {
@@ -175,6 +350,12 @@ public:
         root = insert_node(root, value);
     }
 
+    bool remove(T& value) {
+        bool removed = false;
+        root = remove_node(root, value, removed);
+        return removed;
+    }
+
     bool search(T& value) {
         return search_node(root, value);
     }
@@ -182,6 +363,91 @@ public:
     bool empty() {
         return root == nullptr;
     }
+
+    int size() {
+        return get_size(root);
+    }
+
+    Iterator begin() {
+        Iterator it;
+        it.push_left(root);
+        return it;
+    }
+
+    ReverseIterator rbegin() {
+        ReverseIterator it;
+        it.push_right(root);
+        return it;
+    }
+
+    template<typename K>
+    Iterator lower_bound(K key) {
+        Iterator it;
+        Node* node = root;
+        while (node) {
+            if (node->data < key) {
+                node = node->right;
+            } else {
+                it.stack_[it.top_++] = node;
+                node = node->left;
+            }
+        }
+        return it;
+    }
+
+    template<typename K>
+    Iterator upper_bound(K key) {
+        Iterator it;
+        Node* node = root;
+        while (node) {
+            if (key < node->data) {
+                it.stack_[it.top_++] = node;
+                node = node->left;
+            } else {
+                node = node->right;
+            }
+        }
+        return it;
+    }
+
+    template<typename K, typename Visitor>
+    void visit_range(K low, K high, Visitor visit) {
+        visit_range_node(root, low, high, visit);
+    }
+
+    T& kth(int k) {
+        if (k < 0 || k >= size()) {
+            throw "AVLTree rank out of range";
+        }
+        Node* node = root;
+        while (node) {
+            int left_size = get_size(node->left);
+            if (k < left_size) {
+                node = node->left;
+            } else if (k == left_size) {
+                break;
+            } else {
+                k -= left_size + 1;
+                node = node->right;
+            }
+        }
+        return node->data;
+    }
+
+    template<typename K>
+    int rank(K key) {
+        int count = 0;
+        Node* node = root;
+        while (node) {
+            if (node->data < key) {
+                count += get_size(node->left) + 1;
+                node = node->right;
+            } else {
+                node = node->left;
+            }
+        }
+        return count;
+    }
 };
 
 #endif
@@ -4,6 +4,7 @@
 #include "Vector.h"
 #include "Queue.h"
 #include "Stack.h"
+#include "CsrGraph.h"
 
 using namespace std;
 
@@ -186,6 +187,25 @@ public:
         return is_directed_;
     }
 
+    CsrGraph freeze() {
+        Vector<int> degrees(num_vertices_ + 1);
+        int total = 0;
+        for (int v = 0; v < num_vertices_; ++v) {
+            degrees.push_back(adjacency_list_[v].size());
+            total += adjacency_list_[v].size();
+        }
+        Vector<int> targets(total + 1);
+        for (int v = 0; v < num_vertices_; ++v) {
+            Vector<int>& list = adjacency_list_[v];
+            for (int i = 0; i < list.size(); ++i) {
+                targets.push_back(list[i]);
+            }
+        }
+        CsrGraph frozen(is_directed_);
+        frozen.assemble(num_vertices_, &degrees, &targets, 1, is_directed_);
+        return frozen;
+    }
+
     Vector<int> bfs(int start_vertex) {
         if (start_vertex < 0 || start_vertex >= num_vertices_) {
             throw "Vertex index out of range";
@@ -206,7 +226,7 @@ public:
             q.dequeue();
             result.push_back(current);
 
-            Vector<int> neighbors = get_neighbors(current);
+            Vector<int>& neighbors = adjacency_list_[current];
             for (int i = 0; i < neighbors.size(); ++i) {
                 int neighbor = neighbors[i];
                 if (!visited[neighbor]) {
@@ -241,7 +261,7 @@ public:
                 visited[current] = true;
                 result.push_back(current);
 
-                Vector<int> neighbors = get_neighbors(current);
+                Vector<int>& neighbors = adjacency_list_[current];
                 for (int i = neighbors.size() - 1; i >= 0; --i) {
                     int neighbor = neighbors[i];
                     if (!visited[neighbor]) {
@@ -0,0 +1,100 @@
+#ifndef COMPANY_SERIES_INDEX_H
+#define COMPANY_SERIES_INDEX_H
+
+using namespace std;
+
+class CompanySeriesIndex {
+private:
+    int* offsets_;
+    int* rows_;
+    int company_count_;
+    int row_count_;
+
+    void release() {
+        delete[] offsets_;
+        delete[] rows_;
+        offsets_ = nullptr;
+        rows_ = nullptr;
+        company_count_ = 0;
+        row_count_ = 0;
+    }
+
+    static void sort_span_by_year(int* span, int count, int* years) {
+        for (int i = 1; i < count; ++i) {
+            int row = span[i];
+            int year = years[row];
+            int j = i - 1;
+            while (j >= 0 && years[span[j]] > year) {
+                span[j + 1] = span[j];
+                j--;
+            }
+            span[j + 1] = row;
+        }
+    }
+
+public:
+    explicit CompanySeriesIndex() : offsets_(nullptr), rows_(nullptr), company_count_(0), row_count_(0) {}
+
+    CompanySeriesIndex(const CompanySeriesIndex& other) = delete;
+    CompanySeriesIndex& operator=(const CompanySeriesIndex& other) = delete;
+
+    ~CompanySeriesIndex() {
+        release();
+    }
+
+    void clear() {
+        release();
+    }
+
+    void build(int* company_ids, int* years, int row_count, int company_count) {
+        release();
+        company_count_ = company_count;
+        row_count_ = row_count;
+        offsets_ = new int[company_count + 1];
+        rows_ = new int[row_count + 1];
+        for (int c = 0; c <= company_count; ++c) {
+            offsets_[c] = 0;
+        }
+        for (int i = 0; i < row_count; ++i) {
+            offsets_[company_ids[i] + 1]++;
+        }
+        for (int c = 0; c < company_count; ++c) {
+            offsets_[c + 1] += offsets_[c];
+        }
+        int* cursor = new int[company_count + 1];
+        for (int c = 0; c < company_count; ++c) {
+            cursor[c] = offsets_[c];
+        }
+        for (int i = 0; i < row_count; ++i) {
+            rows_[cursor[company_ids[i]]++] = i;
+        }
+        delete[] cursor;
+        for (int c = 0; c < company_count; ++c) {
+            sort_span_by_year(rows_ + offsets_[c], offsets_[c + 1] - offsets_[c], years);
+        }
+    }
+
+    int company_count() {
+        return company_count_;
+    }
+
+    int size() {
+        return row_count_;
+    }
+
+    int length(int company_id) {
+        if (company_id < 0 || company_id >= company_count_) {
+            throw "Company id out of range";
+        }
+        return offsets_[company_id + 1] - offsets_[company_id];
+    }
+
+    int* rows(int company_id) {
+        if (company_id < 0 || company_id >= company_count_) {
+            throw "Company id out of range";
+        }
+        return rows_ + offsets_[company_id];
+    }
+};
+
+#endif
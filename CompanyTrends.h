@@ -0,0 +1,278 @@
+#ifndef COMPANY_TRENDS_H
+#define COMPANY_TRENDS_H
+
+#include "CompanySeriesIndex.h"
+#include "Parallel.h"
+
+using namespace std;
+
+class CompanyTrendKernel {
+private:
+    static const int LANES = 64;
+    static const int MIN_BLOCKS_PER_THREAD = 16;
+
+    int company_count_;
+    int row_count_;
+    int* points_;
+    int* latest_row_;
+    double* slope_;
+    double* intercept_;
+    double* r_squared_;
+    double* forecast_;
+    double* residual_;
+
+    void release() {
+        delete[] points_;
+        delete[] latest_row_;
+        delete[] slope_;
+        delete[] intercept_;
+        delete[] r_squared_;
+        delete[] forecast_;
+        delete[] residual_;
+        points_ = nullptr;
+        latest_row_ = nullptr;
+        slope_ = nullptr;
+        intercept_ = nullptr;
+        r_squared_ = nullptr;
+        forecast_ = nullptr;
+        residual_ = nullptr;
+        company_count_ = 0;
+        row_count_ = 0;
+    }
+
+    static int member_count(CompanySeriesIndex& index, int company, bool* members) {
+        int span = index.length(company);
+        if (members == nullptr) {
+            return span;
+        }
+        int* rows = index.rows(company);
+        int count = 0;
+        for (int t = 0; t < span; ++t) {
+            if (members[rows[t]]) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    void fit_block(CompanySeriesIndex& index, int* years, double* values, bool* members, int first, int lanes,
+                   double*& x, double*& y, double*& mask, int& capacity) {
+        int* len = points_ + first;
+        int depth = 0;
+        for (int l = 0; l < lanes; ++l) {
+            len[l] = member_count(index, first + l, members);
+            if (len[l] > depth) {
+                depth = len[l];
+            }
+        }
+        if (depth * LANES > capacity) {
+            delete[] x;
+            delete[] y;
+            delete[] mask;
+            capacity = depth * LANES;
+            x = new double[capacity];
+            y = new double[capacity];
+            mask = new double[capacity];
+        }
+        double base[LANES];
+        for (int l = 0; l < LANES; ++l) {
+            int span = l < lanes ? index.length(first + l) : 0;
+            int* rows = l < lanes ? index.rows(first + l) : nullptr;
+            int t = 0;
+            base[l] = 0.0;
+            for (int k = 0; k < span; ++k) {
+                int row = rows[k];
+                if (members != nullptr && !members[row]) {
+                    continue;
+                }
+                if (t == 0) {
+                    base[l] = (double)years[row];
+                }
+                int at = t * LANES + l;
+                x[at] = (double)years[row] - base[l];
+                y[at] = values[row];
+                mask[at] = 1.0;
+                t++;
+            }
+            for (; t < depth; ++t) {
+                int at = t * LANES + l;
+                x[at] = 0.0;
+                y[at] = 0.0;
+                mask[at] = 0.0;
+            }
+        }
+
+        double mean_x[LANES];
+        double mean_y[LANES];
+        double sxx[LANES];
+        double sxy[LANES];
+        double syy[LANES];
+        double ss_res[LANES];
+        for (int l = 0; l < LANES; ++l) {
+            mean_x[l] = 0.0;
+            mean_y[l] = 0.0;
+            sxx[l] = 0.0;
+            sxy[l] = 0.0;
+            syy[l] = 0.0;
+            ss_res[l] = 0.0;
+        }
+        for (int t = 0; t < depth; ++t) {
+            double* xt = x + t * LANES;
+            double* yt = y + t * LANES;
+            for (int l = 0; l < LANES; ++l) {
+                mean_x[l] += xt[l];
+                mean_y[l] += yt[l];
+            }
+        }
+        for (int l = 0; l < lanes; ++l) {
+            double n = len[l] > 0 ? (double)len[l] : 1.0;
+            mean_x[l] /= n;
+            mean_y[l] /= n;
+        }
+        for (int t = 0; t < depth; ++t) {
+            double* xt = x + t * LANES;
+            double* yt = y + t * LANES;
+            double* mt = mask + t * LANES;
+            for (int l = 0; l < LANES; ++l) {
+                double dx = (xt[l] - mean_x[l]) * mt[l];
+                double dy = (yt[l] - mean_y[l]) * mt[l];
+                sxx[l] += dx * dx;
+                sxy[l] += dx * dy;
+                syy[l] += dy * dy;
+            }
+        }
+        double* slope = slope_ + first;
+        double* intercept = intercept_ + first;
+        double local_slope[LANES];
+        double local_intercept[LANES];
+        for (int l = 0; l < LANES; ++l) {
+            local_slope[l] = sxx[l] > 0.0 ? sxy[l] / sxx[l] : 0.0;
+            local_intercept[l] = mean_y[l] - local_slope[l] * mean_x[l];
+        }
+        for (int t = 0; t < depth; ++t) {
+            double* xt = x + t * LANES;
+            double* yt = y + t * LANES;
+            double* mt = mask + t * LANES;
+            for (int l = 0; l < LANES; ++l) {
+                double r = (yt[l] - (local_intercept[l] + local_slope[l] * xt[l])) * mt[l];
+                yt[l] = r;
+                ss_res[l] += r * r;
+            }
+        }
+        for (int l = 0; l < lanes; ++l) {
+            int c = first + l;
+            int* rows = index.rows(c);
+            slope[l] = local_slope[l];
+            intercept[l] = local_intercept[l] - local_slope[l] * base[l];
+            r_squared_[c] = syy[l] > 0.0 ? 1.0 - ss_res[l] / syy[l] : 1.0;
+            if (len[l] == 0) {
+                latest_row_[c] = -1;
+                forecast_[c] = 0.0;
+                r_squared_[c] = 0.0;
+                continue;
+            }
+            int t = 0;
+            int latest = -1;
+            for (int k = 0; k < index.length(c); ++k) {
+                if (members != nullptr && !members[rows[k]]) {
+                    continue;
+                }
+                residual_[rows[k]] = y[t * LANES + l];
+                latest = rows[k];
+                t++;
+            }
+            latest_row_[c] = latest;
+            forecast_[c] = local_intercept[l] + local_slope[l] * ((double)(years[latest] + 1) - base[l]);
+        }
+    }
+
+public:
+    explicit CompanyTrendKernel()
+        : company_count_(0), row_count_(0), points_(nullptr), latest_row_(nullptr), slope_(nullptr),
+          intercept_(nullptr), r_squared_(nullptr), forecast_(nullptr), residual_(nullptr) {}
+
+    CompanyTrendKernel(const CompanyTrendKernel& other) = delete;
+    CompanyTrendKernel& operator=(const CompanyTrendKernel& other) = delete;
+
+    ~CompanyTrendKernel() {
+        release();
+    }
+
+    void clear() {
+        release();
+    }
+
+    void build(CompanySeriesIndex& index, int* years, double* values, int num_threads = 0, bool* members = nullptr) {
+        release();
+        int companies = index.company_count();
+        company_count_ = companies;
+        row_count_ = index.size();
+        points_ = new int[companies + 1];
+        latest_row_ = new int[companies + 1];
+        slope_ = new double[companies + 1];
+        intercept_ = new double[companies + 1];
+        r_squared_ = new double[companies + 1];
+        forecast_ = new double[companies + 1];
+        residual_ = new double[row_count_ + 1];
+        for (int i = 0; i < row_count_; ++i) {
+            residual_[i] = 0.0;
+        }
+        int blocks = (companies + LANES - 1) / LANES;
+        int threads = Parallel::clamp_threads(num_threads, blocks / MIN_BLOCKS_PER_THREAD + 1);
+        Parallel::for_each_range(blocks, threads, [&](int, int begin, int end) {
+            double* x = nullptr;
+            double* y = nullptr;
+            double* mask = nullptr;
+            int capacity = 0;
+            for (int b = begin; b < end; ++b) {
+                int first = b * LANES;
+                int lanes = companies - first < LANES ? companies - first : LANES;
+                fit_block(index, years, values, members, first, lanes, x, y, mask, capacity);
+            }
+            delete[] x;
+            delete[] y;
+            delete[] mask;
+        });
+    }
+
+    int company_count() {
+        return company_count_;
+    }
+
+    int points(int company_id) {
+        return points_[company_id];
+    }
+
+    int latest_row(int company_id) {
+        return latest_row_[company_id];
+    }
+
+    double slope(int company_id) {
+        return slope_[company_id];
+    }
+
+    double intercept(int company_id) {
+        return intercept_[company_id];
+    }
+
+    double r_squared(int company_id) {
+        return r_squared_[company_id];
+    }
+
+    double forecast(int company_id) {
+        return forecast_[company_id];
+    }
+
+    double residual(int row) {
+        if (row < 0 || row >= row_count_) {
+            throw "Row index out of range";
+        }
+        return residual_[row];
+    }
+
+    double* residuals() {
+        return residual_;
+    }
+};
+
+#endif
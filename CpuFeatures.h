@@ -0,0 +1,84 @@
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CPU_FEATURES_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(CPU_FEATURES_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX2_FMA __attribute__((target("avx2,fma")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#define TARGET_AVX2_FMA
+#endif
+
+using namespace std;
+
+class CpuFeatures {
+private:
+    struct Flags {
+        bool sse2;
+        bool avx2;
+        bool fma;
+    };
+
+    static Flags detect() {
+        Flags f;
+        f.sse2 = false;
+        f.avx2 = false;
+        f.fma = false;
+#if defined(CPU_FEATURES_X86) && (defined(__GNUC__) || defined(__clang__))
+        __builtin_cpu_init();
+        f.sse2 = __builtin_cpu_supports("sse2") != 0;
+        f.avx2 = __builtin_cpu_supports("avx2") != 0;
+        f.fma = __builtin_cpu_supports("fma") != 0;
+#elif defined(CPU_FEATURES_X86) && defined(_MSC_VER)
+        int regs[4];
+        __cpuid(regs, 0);
+        int max_leaf = regs[0];
+        __cpuid(regs, 1);
+        f.sse2 = (regs[3] & (1 << 26)) != 0;
+        bool osxsave = (regs[2] & (1 << 27)) != 0;
+        bool avx = (regs[2] & (1 << 28)) != 0;
+        bool fma = (regs[2] & (1 << 12)) != 0;
+        bool ymm_enabled = false;
+        if (osxsave && avx) {
+            unsigned long long xcr0 = _xgetbv(0);
+            ymm_enabled = (xcr0 & 0x6) == 0x6;
+        }
+        if (ymm_enabled && max_leaf >= 7) {
+            __cpuidex(regs, 7, 0);
+            f.avx2 = (regs[1] & (1 << 5)) != 0;
+            f.fma = fma;
+        }
+#endif
+        return f;
+    }
+
+    static Flags& flags() {
+        static Flags cached = detect();
+        return cached;
+    }
+
+public:
+    static bool has_sse2() {
+        return flags().sse2;
+    }
+
+    static bool has_avx2() {
+        return flags().avx2;
+    }
+
+    static bool has_fma() {
+        return flags().fma;
+    }
+};
+
+#endif
@@ -0,0 +1,494 @@
+#ifndef CSR_GRAPH_H
+#define CSR_GRAPH_H
+
+#include "Vector.h"
+
+using namespace std;
+
+class CsrGraph {
+private:
+    bool is_directed_;
+    bool sorted_;
+    int num_vertices_;
+    int* offsets_;
+    int* targets_;
+
+    void release() {
+        delete[] offsets_;
+        delete[] targets_;
+        offsets_ = nullptr;
+        targets_ = nullptr;
+        num_vertices_ = 0;
+    }
+
+    void copy_from(const CsrGraph& other) {
+        is_directed_ = other.is_directed_;
+        sorted_ = other.sorted_;
+        num_vertices_ = other.num_vertices_;
+        if (other.offsets_ == nullptr) {
+            return;
+        }
+        int edges = other.offsets_[num_vertices_];
+        offsets_ = new int[num_vertices_ + 1];
+        targets_ = new int[edges + 1];
+        for (int v = 0; v <= num_vertices_; ++v) {
+            offsets_[v] = other.offsets_[v];
+        }
+        for (int e = 0; e < edges; ++e) {
+            targets_[e] = other.targets_[e];
+        }
+    }
+
+public:
+    static void sort_ints(int* a, int lo, int hi) {
+        while (hi - lo > 16) {
+            int pivot = a[(lo + hi) / 2];
+            int i = lo;
+            int j = hi - 1;
+            while (i <= j) {
+                while (a[i] < pivot) {
+                    i++;
+                }
+                while (a[j] > pivot) {
+                    j--;
+                }
+                if (i <= j) {
+                    int t = a[i];
+                    a[i] = a[j];
+                    a[j] = t;
+                    i++;
+                    j--;
+                }
+            }
+            if (j - lo < hi - i) {
+                sort_ints(a, lo, j + 1);
+                lo = i;
+            } else {
+                sort_ints(a, i, hi);
+                hi = j + 1;
+            }
+        }
+        for (int i = lo + 1; i < hi; ++i) {
+            int v = a[i];
+            int j = i - 1;
+            while (j >= lo && a[j] > v) {
+                a[j + 1] = a[j];
+                j--;
+            }
+            a[j + 1] = v;
+        }
+    }
+
+    static void radix_sort(int* a, int count, int* scratch, int max_value) {
+        int* src = a;
+        int* dst = scratch;
+        int buckets[257];
+        for (int shift = 0; shift == 0 || (max_value >> shift) > 0; shift += 8) {
+            for (int b = 0; b < 257; ++b) {
+                buckets[b] = 0;
+            }
+            for (int i = 0; i < count; ++i) {
+                buckets[((src[i] >> shift) & 255) + 1]++;
+            }
+            for (int b = 0; b < 256; ++b) {
+                buckets[b + 1] += buckets[b];
+            }
+            for (int i = 0; i < count; ++i) {
+                dst[buckets[(src[i] >> shift) & 255]++] = src[i];
+            }
+            int* t = src;
+            src = dst;
+            dst = t;
+        }
+        if (src != a) {
+            for (int i = 0; i < count; ++i) {
+                a[i] = src[i];
+            }
+        }
+    }
+
+    static void sort_targets(int* a, int count, int* scratch, int max_value) {
+        if (count > RADIX_THRESHOLD && scratch != nullptr) {
+            radix_sort(a, count, scratch, max_value);
+        } else {
+            sort_ints(a, 0, count);
+        }
+    }
+
+private:
+    static const int RADIX_THRESHOLD = 96;
+
+    void sort_and_dedupe() {
+        int write = 0;
+        int begin = 0;
+        for (int v = 0; v < num_vertices_; ++v) {
+            int end = offsets_[v + 1];
+            sort_ints(targets_, begin, end);
+            offsets_[v] = write;
+            for (int e = begin; e < end; ++e) {
+                if (e == begin || targets_[e] != targets_[e - 1]) {
+                    targets_[write++] = targets_[e];
+                }
+            }
+            begin = end;
+        }
+        offsets_[num_vertices_] = write;
+    }
+
+public:
+    struct Span {
+        int* data;
+        int count;
+
+        int* begin() {
+            return data;
+        }
+
+        int* end() {
+            return data + count;
+        }
+
+        int size() {
+            return count;
+        }
+
+        int operator[](int index) {
+            if (index < 0 || index >= count) {
+                throw "Span index out of range";
+            }
+            return data[index];
+        }
+    };
+
+    explicit CsrGraph(bool is_directed = false)
+        : is_directed_(is_directed), sorted_(true), num_vertices_(0), offsets_(nullptr), targets_(nullptr) {}
+
+    CsrGraph(const CsrGraph& other) : is_directed_(false), sorted_(true), num_vertices_(0), offsets_(nullptr), targets_(nullptr) {
+        copy_from(other);
+    }
+
+    CsrGraph(CsrGraph&& other)
+        : is_directed_(other.is_directed_), sorted_(other.sorted_), num_vertices_(other.num_vertices_), offsets_(other.offsets_), targets_(other.targets_) {
+        other.offsets_ = nullptr;
+        other.targets_ = nullptr;
+        other.num_vertices_ = 0;
+    }
+
+    CsrGraph& operator=(const CsrGraph& other) {
+        if (this != &other) {
+            release();
+            copy_from(other);
+        }
+        return *this;
+    }
+
+    CsrGraph& operator=(CsrGraph&& other) {
+        if (this != &other) {
+            release();
+            is_directed_ = other.is_directed_;
+            sorted_ = other.sorted_;
+            num_vertices_ = other.num_vertices_;
+            offsets_ = other.offsets_;
+            targets_ = other.targets_;
+            other.offsets_ = nullptr;
+            other.targets_ = nullptr;
+            other.num_vertices_ = 0;
+        }
+        return *this;
+    }
+
+    ~CsrGraph() {
+        release();
+    }
+
+    void build(int num_vertices, Vector<int>* from, Vector<int>* to, int buffer_count, bool is_directed) {
+        release();
+        is_directed_ = is_directed;
+        num_vertices_ = num_vertices;
+        offsets_ = new int[num_vertices + 1];
+        for (int v = 0; v <= num_vertices; ++v) {
+            offsets_[v] = 0;
+        }
+        long long total = 0;
+        for (int b = 0; b < buffer_count; ++b) {
+            for (int e = 0; e < from[b].size(); ++e) {
+                int u = from[b][e];
+                int v = to[b][e];
+                if (u < 0 || u >= num_vertices || v < 0 || v >= num_vertices) {
+                    throw "Vertex index out of range";
+                }
+                offsets_[u + 1]++;
+                total++;
+                if (!is_directed) {
+                    offsets_[v + 1]++;
+                    total++;
+                }
+            }
+        }
+        if (total > 2147483647LL) {
+            throw "Too many edges for CSR graph";
+        }
+        for (int v = 0; v < num_vertices; ++v) {
+            offsets_[v + 1] += offsets_[v];
+        }
+        targets_ = new int[total + 1];
+        int* cursor = new int[num_vertices + 1];
+        for (int v = 0; v < num_vertices; ++v) {
+            cursor[v] = offsets_[v];
+        }
+        for (int b = 0; b < buffer_count; ++b) {
+            for (int e = 0; e < from[b].size(); ++e) {
+                int u = from[b][e];
+                int v = to[b][e];
+                targets_[cursor[u]++] = v;
+                if (!is_directed) {
+                    targets_[cursor[v]++] = u;
+                }
+            }
+        }
+        delete[] cursor;
+        sort_and_dedupe();
+        sorted_ = true;
+    }
+
+    void assemble(int num_vertices, Vector<int>* row_degrees, Vector<int>* row_targets, int part_count, bool is_directed) {
+        release();
+        is_directed_ = is_directed;
+        num_vertices_ = num_vertices;
+        offsets_ = new int[num_vertices + 1];
+        long long total = 0;
+        int v = 0;
+        for (int p = 0; p < part_count; ++p) {
+            for (int i = 0; i < row_degrees[p].size(); ++i) {
+                if (v >= num_vertices) {
+                    throw "Vertex index out of range";
+                }
+                offsets_[v++] = (int)total;
+                total += row_degrees[p][i];
+            }
+        }
+        if (v != num_vertices) {
+            throw "CSR row count does not match vertex count";
+        }
+        if (total > 2147483647LL) {
+            throw "Too many edges for CSR graph";
+        }
+        offsets_[num_vertices] = (int)total;
+        targets_ = new int[total + 1];
+        int write = 0;
+        for (int p = 0; p < part_count; ++p) {
+            int count = row_targets[p].size();
+            if (count == 0) {
+                continue;
+            }
+            int* src = &row_targets[p][0];
+            for (int e = 0; e < count; ++e) {
+                targets_[write++] = src[e];
+            }
+        }
+        sorted_ = true;
+        for (int u = 0; u < num_vertices && sorted_; ++u) {
+            for (int e = offsets_[u] + 1; e < offsets_[u + 1]; ++e) {
+                if (targets_[e - 1] >= targets_[e]) {
+                    sorted_ = false;
+                    break;
+                }
+            }
+        }
+    }
+
+    void build(int num_vertices, Vector<int>& from, Vector<int>& to, bool is_directed) {
+        build(num_vertices, &from, &to, 1, is_directed);
+    }
+
+    int num_vertices() {
+        return num_vertices_;
+    }
+
+    int num_edges() {
+        if (offsets_ == nullptr) {
+            return 0;
+        }
+        return is_directed_ ? offsets_[num_vertices_] : offsets_[num_vertices_] / 2;
+    }
+
+    bool is_directed() {
+        return is_directed_;
+    }
+
+    int degree(int vertex) {
+        if (vertex < 0 || vertex >= num_vertices_) {
+            throw "Vertex index out of range";
+        }
+        return offsets_[vertex + 1] - offsets_[vertex];
+    }
+
+    int* neighbors(int vertex) {
+        if (vertex < 0 || vertex >= num_vertices_) {
+            throw "Vertex index out of range";
+        }
+        return targets_ + offsets_[vertex];
+    }
+
+    Span neighbor_span(int vertex) {
+        if (vertex < 0 || vertex >= num_vertices_) {
+            throw "Vertex index out of range";
+        }
+        Span span;
+        span.data = targets_ + offsets_[vertex];
+        span.count = offsets_[vertex + 1] - offsets_[vertex];
+        return span;
+    }
+
+    bool has_edge(int from, int to) {
+        if (from < 0 || from >= num_vertices_ || to < 0 || to >= num_vertices_) {
+            return false;
+        }
+        if (!sorted_) {
+            for (int e = offsets_[from]; e < offsets_[from + 1]; ++e) {
+                if (targets_[e] == to) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        int lo = offsets_[from];
+        int hi = offsets_[from + 1];
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (targets_[mid] < to) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo < offsets_[from + 1] && targets_[lo] == to;
+    }
+
+    Vector<int> get_neighbors(int vertex) {
+        int count = degree(vertex);
+        int* adj = neighbors(vertex);
+        Vector<int> out(count + 1);
+        for (int i = 0; i < count; ++i) {
+            out.push_back(adj[i]);
+        }
+        return out;
+    }
+
+    int bfs(int start_vertex, int* order, unsigned char* visited, int* labels = nullptr, int label = 0) {
+        if (start_vertex < 0 || start_vertex >= num_vertices_) {
+            throw "Vertex index out of range";
+        }
+        int head = 0;
+        int tail = 0;
+        visited[start_vertex] = 1;
+        order[tail++] = start_vertex;
+        while (head < tail) {
+            int current = order[head++];
+            if (labels != nullptr) {
+                labels[current] = label;
+            }
+            for (int e = offsets_[current]; e < offsets_[current + 1]; ++e) {
+                int neighbor = targets_[e];
+                if (!visited[neighbor]) {
+                    visited[neighbor] = 1;
+                    order[tail++] = neighbor;
+                }
+            }
+        }
+        return tail;
+    }
+
+    int dfs(int start_vertex, int* order, unsigned char* visited, int* stack, int* cursor) {
+        if (start_vertex < 0 || start_vertex >= num_vertices_) {
+            throw "Vertex index out of range";
+        }
+        int count = 0;
+        int depth = 0;
+        visited[start_vertex] = 1;
+        order[count++] = start_vertex;
+        stack[depth] = start_vertex;
+        cursor[depth] = offsets_[start_vertex];
+        depth++;
+        while (depth > 0) {
+            int current = stack[depth - 1];
+            int& e = cursor[depth - 1];
+            while (e < offsets_[current + 1] && visited[targets_[e]]) {
+                e++;
+            }
+            if (e == offsets_[current + 1]) {
+                depth--;
+                continue;
+            }
+            int next = targets_[e++];
+            visited[next] = 1;
+            order[count++] = next;
+            stack[depth] = next;
+            cursor[depth] = offsets_[next];
+            depth++;
+        }
+        return count;
+    }
+
+    Vector<int> bfs(int start_vertex) {
+        int* order = new int[num_vertices_ + 1];
+        unsigned char* visited = new unsigned char[num_vertices_ + 1]();
+        int count = bfs(start_vertex, order, visited);
+        Vector<int> result(count + 1);
+        for (int i = 0; i < count; ++i) {
+            result.push_back(order[i]);
+        }
+        delete[] order;
+        delete[] visited;
+        return result;
+    }
+
+    Vector<int> dfs(int start_vertex) {
+        int* order = new int[num_vertices_ + 1];
+        int* stack = new int[num_vertices_ + 1];
+        int* cursor = new int[num_vertices_ + 1];
+        unsigned char* visited = new unsigned char[num_vertices_ + 1]();
+        int count = dfs(start_vertex, order, visited, stack, cursor);
+        Vector<int> result(count + 1);
+        for (int i = 0; i < count; ++i) {
+            result.push_back(order[i]);
+        }
+        delete[] order;
+        delete[] stack;
+        delete[] cursor;
+        delete[] visited;
+        return result;
+    }
+
+    int connected_components(int* labels) {
+        if (num_vertices_ == 0) {
+            return 0;
+        }
+        int* queue = new int[num_vertices_ + 1];
+        unsigned char* visited = new unsigned char[num_vertices_ + 1]();
+        int components = 0;
+        for (int v = 0; v < num_vertices_; ++v) {
+            if (!visited[v]) {
+                bfs(v, queue, visited, labels, components);
+                components++;
+            }
+        }
+        delete[] queue;
+        delete[] visited;
+        return components;
+    }
+
+    int connected_components(Vector<int>& labels) {
+        labels.clear();
+        labels.reserve(num_vertices_ + 1);
+        for (int v = 0; v < num_vertices_; ++v) {
+            labels.push_back(-1);
+        }
+        if (num_vertices_ == 0) {
+            return 0;
+        }
+        return connected_components(&labels[0]);
+    }
+};
+
+#endif
@@ -5,8 +5,10 @@
 #include <fstream>
 #include <sstream>
 #include <string>
-#include <cstdlib>
-#include <ctime>
+#include <string_view>
+#include <charconv>
+#include "MappedFile.h"
+#include "Parallel.h"
 class CsvParser {
 private:
     static string trim(const string& s) {
@@ -68,17 +70,155 @@ private:
         return tokens;
     }
 
+    static bool is_space(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    static double to_double(const char* begin, const char* end, bool& ok) {
+        ok = true;
+        while (begin < end && is_space(*begin)) {
+            begin++;
+        }
+        while (end > begin && is_space(*(end - 1))) {
+            end--;
+        }
+        if (begin < end && *begin == '+') {
+            begin++;
+        }
+        if (begin == end) {
+            ok = false;
+            return 0.0;
+        }
+        double v = 0.0;
+        std::from_chars_result res = std::from_chars(begin, end, v);
+        if (res.ec != std::errc()) {
+            ok = false;
+            return 0.0;
+        }
+        return v;
+    }
+
+    static double to_double(string_view token, bool& ok) {
+        return to_double(token.data(), token.data() + token.size(), ok);
+    }
+
+    static string_view trim_view(string_view token) {
+        int start = 0;
+        int end = (int)token.size();
+        while (start < end && is_space(token[start])) {
+            start++;
+        }
+        while (end > start && is_space(token[end - 1])) {
+            end--;
+        }
+        return token.substr(start, end - start);
+    }
+
+    static int split_view(const char* begin, const char* end, string_view* cols, int max_cols) {
+        int count = 0;
+        const char* field = begin;
+        for (const char* p = begin; p < end; ++p) {
+            if (*p == ',') {
+                if (count < max_cols) {
+                    cols[count] = string_view(field, p - field);
+                }
+                count++;
+                field = p + 1;
+            }
+        }
+        if (count < max_cols) {
+            cols[count] = string_view(field, end - field);
+        }
+        return count + 1;
+    }
+
+    static bool build_stock(string_view* cols, Stock& s) {
+        s.price = to_double(cols[1], s.valid);
+        s.sector = string(trim_view(cols[2]));
+        s.company_name = string(trim_view(cols[3]));
+        s.year = 2022;
+        bool ok = true;
+        s.latest_eps = to_double(cols[4], ok);
+        s.eps_last_quarter = to_double(cols[5], ok);
+        s.last_annual_eps = to_double(cols[6], ok);
+        s.pe = to_double(cols[7], ok);
+        s.expected_pe = to_double(cols[8], ok);
+        s.expected_growth = to_double(cols[9], ok);
+        s.peg = to_double(cols[10], ok);
+        s.book_value = to_double(cols[11], ok);
+        s.expected_book_value = to_double(cols[12], ok);
+        s.pb = to_double(cols[13], ok);
+        s.expected_pb = to_double(cols[14], ok);
+        s.roe = to_double(cols[15], ok);
+        s.expected_roe = to_double(cols[16], ok);
+        s.equity_to_asset = to_double(cols[17], ok);
+        s.roa = to_double(cols[18], ok);
+        s.last_dividend = to_double(cols[19], ok);
+        s.expected_dividend = to_double(cols[20], ok);
+        s.validate();
+        if (!s.valid) {
+            return false;
+        }
+        s.compute_derived();
+        return true;
+    }
+
+    static const char* parse_header(const char* p, const char* end, Vector<string>& header_out) {
+        while (p < end) {
+            const char* line_end = p;
+            while (line_end < end && *line_end != '\n') {
+                line_end++;
+            }
+            const char* line_begin = p;
+            p = line_end < end ? line_end + 1 : end;
+            if (line_end == line_begin) {
+                continue;
+            }
+            const char* field = line_begin;
+            for (const char* q = line_begin; q <= line_end; ++q) {
+                if (q == line_end || *q == ',') {
+                    header_out.push_back(string(trim_view(string_view(field, q - field))));
+                    field = q < line_end ? q + 1 : line_end;
+                }
+            }
+            break;
+        }
+        return p;
+    }
+
+    static void parse_rows(const char* p, const char* end, Vector<Stock>& out_stocks) {
+        string_view cols[STOCK_COLUMNS];
+        while (p < end) {
+            const char* line_end = p;
+            while (line_end < end && *line_end != '\n') {
+                line_end++;
+            }
+            const char* line_begin = p;
+            p = line_end < end ? line_end + 1 : end;
+            if (line_end == line_begin) {
+                continue;
+            }
+            int count = split_view(line_begin, line_end, cols, STOCK_COLUMNS);
+            if (count < STOCK_COLUMNS) {
+                continue;
+            }
+            Stock s;
+            if (!build_stock(cols, s)) {
+                continue;
+            }
+            out_stocks.push_back(s);
+        }
+    }
+
 public:
+    static const int STOCK_COLUMNS = 21;
+    static const int MIN_CHUNK_BYTES = 1 << 20;
+
     static bool parse(const string& path, Vector<Stock>& out_stocks, Vector<string>& header_out) {
         std::ifstream in(path.c_str());
         if (!in.is_open()) {
             return false;
         }
-        static bool seeded = false;
-        if (!seeded) {
-            std::srand((unsigned int)std::time(NULL));
-            seeded = true;
-        }
         string line;
         bool first = true;
         while (std::getline(in, line)) {
@@ -125,45 +265,65 @@ public:
             }
             s.compute_derived();
             out_stocks.push_back(s);
+        }
+        in.close();
+        return true;
+    }
 
-            for (int year_offset = 1; year_offset <= 10; ++year_offset) {
-                Stock sy = s;
-                sy.year = 2022 + year_offset;
-
-                double base = 1.0 + 0.03 * year_offset;
-                double noise_price = (std::rand() / (double)RAND_MAX) * 0.10 - 0.05;
-                double noise_eps = (std::rand() / (double)RAND_MAX) * 0.08 - 0.04;
-                double noise_pe = (std::rand() / (double)RAND_MAX) * 0.06 - 0.03;
-                double factor_price = base + noise_price;
-                double factor_eps = base + noise_eps;
-                double factor_pe = base + noise_pe;
-
-                sy.price = s.price * factor_price;
-                sy.latest_eps = s.latest_eps * factor_eps;
-                sy.eps_last_quarter = s.eps_last_quarter * factor_eps;
-                sy.last_annual_eps = s.last_annual_eps * factor_eps;
-                sy.pe = s.pe * factor_pe;
-                sy.expected_pe = s.expected_pe * factor_pe;
-                sy.expected_growth = s.expected_growth * factor_eps;
-                sy.peg = s.peg * factor_pe;
-                sy.book_value = s.book_value * factor_price;
-                sy.expected_book_value = s.expected_book_value * factor_price;
-                sy.pb = s.pb * factor_pe;
-                sy.expected_pb = s.expected_pb * factor_pe;
-                sy.roe = s.roe * factor_eps;
-                sy.expected_roe = s.expected_roe * factor_eps;
-                sy.equity_to_asset = s.equity_to_asset;
-                sy.roa = s.roa * factor_eps;
-                sy.last_dividend = s.last_dividend * factor_price;
-                sy.expected_dividend = s.expected_dividend * factor_price;
-                sy.validate();
-                if (sy.valid) {
-                    sy.compute_derived();
-                    out_stocks.push_back(sy);
-                }
+    static bool parse_mapped(const string& path, Vector<Stock>& out_stocks, Vector<string>& header_out) {
+        MappedFile file;
+        if (!file.open(path)) {
+            return parse(path, out_stocks, header_out);
+        }
+        const char* end = file.data() + file.size();
+        const char* body = parse_header(file.data(), end, header_out);
+        parse_rows(body, end, out_stocks);
+        return true;
+    }
+
+    static bool parse_parallel(const string& path, Vector<Stock>& out_stocks, Vector<string>& header_out, int num_threads = 0) {
+        MappedFile file;
+        if (!file.open(path)) {
+            return parse(path, out_stocks, header_out);
+        }
+        const char* end = file.data() + file.size();
+        const char* body = parse_header(file.data(), end, header_out);
+        long long body_size = (long long)(end - body);
+        int n = Parallel::clamp_threads(num_threads, (int)(body_size / MIN_CHUNK_BYTES) + 1);
+
+        const char** bounds = new const char*[n + 1];
+        bounds[0] = body;
+        for (int t = 1; t < n; ++t) {
+            const char* cut = body + (body_size * t) / n;
+            if (cut < bounds[t - 1]) {
+                cut = bounds[t - 1];
+            }
+            while (cut > body && cut < end && *(cut - 1) != '\n') {
+                cut++;
             }
+            bounds[t] = cut;
         }
-        in.close();
+        bounds[n] = end;
+
+        Vector<Stock>* parts = new Vector<Stock>[n];
+        Parallel::for_each_range(n, n, [&](int, int first, int last) {
+            for (int t = first; t < last; ++t) {
+                parse_rows(bounds[t], bounds[t + 1], parts[t]);
+            }
+        });
+
+        int total = out_stocks.size();
+        for (int t = 0; t < n; ++t) {
+            total += parts[t].size();
+        }
+        out_stocks.reserve(total);
+        for (int t = 0; t < n; ++t) {
+            for (int i = 0; i < parts[t].size(); ++i) {
+                out_stocks.push_back(std::move(parts[t][i]));
+            }
+        }
+        delete[] parts;
+        delete[] bounds;
         return true;
     }
 };
@@ -2,13 +2,23 @@
 #define DATA_STORE_H
 
 #include "Vector.h"
-#include "HashMap.h"
+#include "FlatHashMap.h"
 #include "AVLTree.h"
 #include "MinHeap.h"
 #include "MaxHeap.h"
 #include "Stock.h"
-#include "AdjacencyListGraph.h"
+#include "CsrGraph.h"
 #include "CsvParser.h"
+#include "HistoryGenerator.h"
+#include "StockTable.h"
+#include "ScanKernels.h"
+#include "MetricIndex.h"
+#include "CompanySeriesIndex.h"
+#include "SectorAggregateCache.h"
+#include "KdTree.h"
+#include "PeerClusters.h"
+#include "CompanyTrends.h"
+#include "Parallel.h"
 #include "Matrix.h"
 #include "LinearRegression.h"
 #include <string>
@@ -19,16 +29,28 @@ using namespace std;
 struct StockPeKey {
     Stock* ref;
     bool operator<(const StockPeKey& other) {
-        if (ref->pe == other.ref->pe) {
+        if (ref->pe != other.ref->pe) {
+            return ref->pe < other.ref->pe;
+        }
+        if (ref->company_name != other.ref->company_name) {
             return ref->company_name < other.ref->company_name;
         }
-        return ref->pe < other.ref->pe;
+        if (ref->year != other.ref->year) {
+            return ref->year < other.ref->year;
+        }
+        return ref < other.ref;
     }
     bool operator>(const StockPeKey& other) {
-        if (ref->pe == other.ref->pe) {
+        if (ref->pe != other.ref->pe) {
+            return ref->pe > other.ref->pe;
+        }
+        if (ref->company_name != other.ref->company_name) {
             return ref->company_name > other.ref->company_name;
         }
-        return ref->pe > other.ref->pe;
+        if (ref->year != other.ref->year) {
+            return ref->year > other.ref->year;
+        }
+        return ref > other.ref;
     }
     bool operator<=(const StockPeKey& other) {
         return !(*this > other);
@@ -68,59 +90,188 @@ struct StockRoeKey {
 
 class DataStore {
 public:
-    HashMap<string, Vector<Stock*>> sectors;
-    HashMap<string, Stock*> by_name;
-    AVLTree<StockPeKey> by_pe;
+    static const int SIMILARITY_DIMS = 5;
+
+    FlatHashMap<string, Vector<Stock*>> sectors;
+    FlatHashMap<string, Stock*> by_name;
+    MetricIndexRegistry indexes;
     MinHeap<StockPeKey> low_pe_heap;
     MaxHeap<StockRoeKey> high_roe_heap;
-    AdjacencyListGraph<int> similarity_graph;
+    CsrGraph similarity_graph;
     Vector<Stock> all_stocks;
+    HistoryGenerator history;
+    StockTable table;
+    CompanySeriesIndex series_index;
+    SectorAggregateCache sector_cache;
+    KdTree<SIMILARITY_DIMS> feature_tree;
+    PeerClusters peer_clusters;
+    CompanyTrendKernel trend_kernel;
 
-    DataStore() : sectors(), by_name(), by_pe(), low_pe_heap(), high_roe_heap(), similarity_graph(false), all_stocks() {
+    DataStore() : sectors(), by_name(), indexes(), low_pe_heap(), high_roe_heap(), similarity_graph(false), all_stocks(), history(), table(), series_index(), sector_cache(), feature_tree(), peer_clusters(), trend_kernel(), heaps_dirty_(false), series_dirty_(false), features_dirty_(false), graph_dirty_(false), clusters_dirty_(false), trend_kernel_dirty_(false), peer_aggregates_() {
+        indexes.declare(METRIC_PE);
+        indexes.declare(METRIC_ROE);
     }
 
     void clear() {
-        sectors = HashMap<string, Vector<Stock*>>();
-        by_name = HashMap<string, Stock*>();
-        by_pe = AVLTree<StockPeKey>();
+        reset_indexes();
+        all_stocks.clear();
+        table.clear();
+        series_index.clear();
+        sector_cache.clear();
+        feature_tree.clear();
+        peer_clusters.clear();
+        trend_kernel.clear();
+        peer_aggregates_.clear();
+    }
+
+    void reset_indexes() {
+        sectors.clear();
+        by_name.clear();
+        indexes.clear_entries();
         low_pe_heap = MinHeap<StockPeKey>();
         high_roe_heap = MaxHeap<StockRoeKey>();
-        similarity_graph = AdjacencyListGraph<int>(false);
-        all_stocks.clear();
+        similarity_graph = CsrGraph(false);
+        heaps_dirty_ = false;
+        series_dirty_ = true;
+        features_dirty_ = true;
+        graph_dirty_ = true;
+        clusters_dirty_ = true;
+        trend_kernel_dirty_ = true;
+    }
+
+    void rebuild_indexes() {
+        reset_indexes();
+        table.build(all_stocks);
+        rebuild_series_if_dirty();
+        sector_cache.build(table);
+        rebuild_features_if_dirty();
+        by_name.reserve(table.company_count());
+        sectors.reserve(table.sector_count());
+        for (int i = 0; i < all_stocks.size(); ++i) {
+            Stock* ptr = &all_stocks[i];
+            insert_stock(ptr);
+        }
+        build_similarity_graph();
+    }
+
+    void declare_index(int metric_id) {
+        indexes.build(all_stocks, metric_id);
+    }
+
+    bool add_stock(Stock& s) {
+        s.validate();
+        if (!s.valid) {
+            return false;
+        }
+        s.compute_derived();
+        bool relocates = all_stocks.size() >= all_stocks.capacity();
+        all_stocks.push_back(s);
+        if (relocates) {
+            rebuild_indexes();
+            return true;
+        }
+        int row = all_stocks.size() - 1;
+        Stock* ptr = &all_stocks[row];
+        table.append_row(*ptr);
+        series_dirty_ = true;
+        features_dirty_ = true;
+        trend_kernel_dirty_ = true;
+        sector_cache.add_row(ptr->sector_id, ptr->pe, ptr->roe, ptr->dividend_yield, ptr->price);
+        insert_stock(ptr);
+        graph_dirty_ = true;
+        clusters_dirty_ = true;
+        return true;
+    }
+
+    bool update_stock(int index, Stock& values) {
+        if (index < 0 || index >= all_stocks.size()) {
+            return false;
+        }
+        Stock* s = &all_stocks[index];
+        Stock updated = values;
+        updated.company_name = s->company_name;
+        updated.sector = s->sector;
+        updated.company_id = s->company_id;
+        updated.sector_id = s->sector_id;
+        updated.year = s->year;
+        updated.validate();
+        if (!updated.valid) {
+            return false;
+        }
+        updated.compute_derived();
+        Stock before = *s;
+        indexes.update(s, updated);
+        table.update_row(index, *s);
+        sector_cache.update_row(s->sector_id, before, *s);
+        trend_kernel_dirty_ = true;
+        features_dirty_ = true;
+        graph_dirty_ = true;
+        clusters_dirty_ = true;
+        heaps_dirty_ = true;
+        return true;
+    }
+
+    CsrGraph& similarity() {
+        rebuild_graph_if_dirty();
+        return similarity_graph;
+    }
+
+    CompanyTrendKernel& company_trends(int num_threads = 0) {
+        if (trend_kernel_dirty_) {
+            rebuild_series_if_dirty();
+            trend_kernel.build(series_index, table.years(), table.column(METRIC_PRICE), num_threads);
+            trend_kernel_dirty_ = false;
+        }
+        return trend_kernel;
+    }
+
+    PeerClusters& clusters() {
+        rebuild_clusters_if_dirty();
+        return peer_clusters;
     }
 
-    bool load_csv(const string& path) {
+    bool load_csv(const string& path, int num_threads = 0) {
         clear();
         Vector<string> headers;
-        bool ok = CsvParser::parse(path, all_stocks, headers);
+        Vector<Stock> snapshot;
+        bool ok = CsvParser::parse_parallel(path, snapshot, headers, num_threads);
         if (!ok) {
             return false;
         }
-        for (int i = 0; i < all_stocks.size(); ++i) {
-            Stock* ptr = &all_stocks[i];
-            insert_stock(ptr);
+        if (history.horizon() > 0) {
+            history.generate_parallel(snapshot, all_stocks, num_threads);
+        } else {
+            all_stocks = std::move(snapshot);
         }
-        build_similarity_graph();
+        rebuild_indexes();
         return true;
     }
 
     void insert_stock(Stock* s) {
-        string name_key = normalize_key(s->company_name);
-        by_name.insert(name_key, s);
-        Vector<Stock*>* sector_vec_ptr;
-        string sector_key = normalize_key(s->sector);
-        if (sectors.contains(sector_key)) {
-            sector_vec_ptr = &sectors[sector_key];
+        char buffer[KEY_BUFFER_SIZE];
+        int len = StockTable::normalize_into(s->company_name, buffer, KEY_BUFFER_SIZE);
+        Stock** named = len >= 0 ? by_name.find(string_view(buffer, len)) : nullptr;
+        if (named != nullptr) {
+            *named = s;
+        } else {
+            by_name.insert(normalize_key(s->company_name), s);
+        }
+        if (s->sector_id != NO_SECTOR) {
+            string& sector_key = table.sector_key(s->sector_id);
+            Vector<Stock*>* members = sectors.find(sector_key);
+            if (members != nullptr) {
+                members->push_back(s);
+            } else {
+                sectors[sector_key].push_back(s);
+            }
         } else {
-            Vector<Stock*> new_vec;
-            sectors.insert(sector_key, new_vec);
-            sector_vec_ptr = &sectors[sector_key];
+            sectors[normalize_key(s->sector)].push_back(s);
         }
-        sector_vec_ptr->push_back(s);
+
+        indexes.insert(s);
 
         StockPeKey pe_key;
         pe_key.ref = s;
-        by_pe.insert(pe_key);
         low_pe_heap.push(pe_key);
 
         StockRoeKey roe_key;
@@ -129,39 +280,169 @@ public:
     }
 
     string normalize_key(string s) {
-        int start = 0;
-        while (start < (int)s.size() && (s[start] == ' ' || s[start] == '\t' || s[start] == '\r' || s[start] == '\n')) {
-            start++;
+        return StockTable::normalize_key(s);
+    }
+
+    Stock* search_by_name(const string& name) {
+        char buffer[KEY_BUFFER_SIZE];
+        int len = StockTable::normalize_into(name, buffer, KEY_BUFFER_SIZE);
+        Stock** found;
+        if (len >= 0) {
+            found = by_name.find(string_view(buffer, len));
+        } else {
+            found = by_name.find(normalize_key(name));
         }
-        int end = (int)s.size() - 1;
-        while (end >= start && (s[end] == ' ' || s[end] == '\t' || s[end] == '\r' || s[end] == '\n')) {
-            end--;
+        if (found == nullptr) {
+            return nullptr;
         }
-        string out = "";
-        for (int i = start; i <= end; ++i) {
-            char c = s[i];
-            if (c >= 'a' && c <= 'z') {
-                c = (char)(c - 'a' + 'A');
+        return *found;
+    }
+
+    Vector<Stock*> latest_by_company(Vector<Stock*>& rows) {
+        Vector<Stock*> result;
+        int companies = table.company_count();
+        int* slot = new int[companies + 1];
+        for (int c = 0; c < companies; ++c) {
+            slot[c] = -1;
+        }
+        for (int i = 0; i < rows.size(); ++i) {
+            Stock* s = rows[i];
+            int c = s->company_id;
+            if (c < 0 || c >= companies) {
+                continue;
+            }
+            if (slot[c] < 0) {
+                slot[c] = result.size();
+                result.push_back(s);
+            } else if (s->year > result[slot[c]]->year) {
+                result[slot[c]] = s;
             }
-            out.push_back(c);
         }
-        return out;
+        delete[] slot;
+        return result;
     }
 
-    Stock* search_by_name(const string& name) {
-        string key = normalize_key(name);
-        if (by_name.contains(key)) {
-            return by_name[key];
+    Vector<Stock*> latest_per_company() {
+        Vector<Stock*> all = all_ptrs();
+        return latest_by_company(all);
+    }
+
+    int company_series(int row_index, int*& rows) {
+        rows = nullptr;
+        if (row_index < 0 || row_index >= table.size()) {
+            return 0;
+        }
+        rebuild_series_if_dirty();
+        int company_id = table.company_ids()[row_index];
+        rows = series_index.rows(company_id);
+        return series_index.length(company_id);
+    }
+
+    void company_history(int row_index, Vector<Stock*>& out) {
+        out.clear();
+        int* rows;
+        int count = company_series(row_index, rows);
+        out.reserve(count + 1);
+        for (int i = 0; i < count; ++i) {
+            out.push_back(&all_stocks[rows[i]]);
+        }
+    }
+
+    struct CompanyPerformance {
+        int points;
+        int latest_row;
+        int first_year;
+        int last_year;
+        double first_price;
+        double last_price;
+        double cagr;
+        double avg_return;
+        double volatility;
+        double best_return;
+        double worst_return;
+        double avg_div_yield;
+    };
+
+    CompanyPerformance company_performance(int row_index) {
+        CompanyPerformance perf;
+        perf.points = 0;
+        perf.latest_row = -1;
+        perf.first_year = 0;
+        perf.last_year = 0;
+        perf.first_price = 0.0;
+        perf.last_price = 0.0;
+        perf.cagr = 0.0;
+        perf.avg_return = 0.0;
+        perf.volatility = 0.0;
+        perf.best_return = 0.0;
+        perf.worst_return = 0.0;
+        perf.avg_div_yield = 0.0;
+        int* rows;
+        int count = company_series(row_index, rows);
+        if (count == 0) {
+            return perf;
+        }
+        double* price = table.column(METRIC_PRICE);
+        double* div_yield = table.column(METRIC_DIVIDEND_YIELD);
+        int* years = table.years();
+        int first = rows[0];
+        int last = rows[count - 1];
+        perf.points = count;
+        perf.latest_row = last;
+        perf.first_year = years[first];
+        perf.last_year = years[last];
+        perf.first_price = price[first];
+        perf.last_price = price[last];
+
+        int years_span = perf.last_year - perf.first_year;
+        if (years_span > 0 && perf.first_price > 0.0 && perf.last_price > 0.0) {
+            perf.cagr = pow(perf.last_price / perf.first_price, 1.0 / (double)years_span) - 1.0;
+        }
+
+        int ret_count = count - 1;
+        double sum_ret = 0.0;
+        double sum_ret_sq = 0.0;
+        for (int i = 0; i < ret_count; ++i) {
+            double p0 = price[rows[i]];
+            double p1 = price[rows[i + 1]];
+            if (p0 <= 0.0) {
+                continue;
+            }
+            double r = (p1 - p0) / p0;
+            sum_ret += r;
+            sum_ret_sq += r * r;
+            if (i == 0 || r < perf.worst_return) {
+                perf.worst_return = r;
+            }
+            if (i == 0 || r > perf.best_return) {
+                perf.best_return = r;
+            }
+        }
+        if (ret_count > 0) {
+            perf.avg_return = sum_ret / (double)ret_count;
+            double var = sum_ret_sq / (double)ret_count - perf.avg_return * perf.avg_return;
+            if (var > 0.0) {
+                perf.volatility = sqrt(var);
+            }
+        }
+
+        double sum_div = 0.0;
+        for (int i = 0; i < count; ++i) {
+            sum_div += div_yield[rows[i]];
         }
-        return nullptr;
+        perf.avg_div_yield = sum_div / (double)count;
+        return perf;
     }
 
     Vector<Stock*> filter_by_sector(const string& sector) {
         Vector<Stock*> result;
-        string key = normalize_key(sector);
-        for (int i = 0; i < all_stocks.size(); ++i) {
-            string stock_key = normalize_key(all_stocks[i].sector);
-            if (stock_key == key) {
+        int sector_id = table.find_sector(sector);
+        if (sector_id < 0) {
+            return result;
+        }
+        int* sector_col = table.sector_ids();
+        for (int i = 0; i < table.size(); ++i) {
+            if (sector_col[i] == sector_id) {
                 result.push_back(&all_stocks[i]);
             }
         }
@@ -169,44 +450,135 @@ public:
     }
 
     void collect_pe_range(double min_pe, double max_pe, Vector<Stock*>& out) {
-        for (int i = 0; i < all_stocks.size(); ++i) {
-            double v = all_stocks[i].pe;
-            if (v >= min_pe && v <= max_pe) {
-                out.push_back(&all_stocks[i]);
-            }
+        collect_range(METRIC_PE, min_pe, max_pe, out);
+    }
+
+    void collect_range(int metric_id, double low, double high, Vector<Stock*>& out) {
+        if (indexes.has_index(metric_id)) {
+            indexes.range(metric_id, low, high, out);
+            return;
+        }
+        SelectionBitmap selected;
+        ScanKernels::filter_range(table.column(metric_id), table.size(), low, high, selected);
+        Vector<int> rows(selected.count() + 1);
+        selected.to_indices(rows);
+        for (int i = 0; i < rows.size(); ++i) {
+            out.push_back(&all_stocks[rows[i]]);
         }
         if (out.size() > 1) {
-            sort_by_metric(out, 1);
+            sort_by_metric(out, metric_id);
         }
     }
 
-    Vector<Stock*> top_n_roe(int n) {
+    double pe_percentile(double q) {
+        return metric_percentile(METRIC_PE, q);
+    }
+
+    double pe_percentile_rank(double pe_value) {
+        return metric_percentile_rank(METRIC_PE, pe_value);
+    }
+
+    double metric_percentile(int metric_id, double q) {
+        if (!indexes.has_index(metric_id)) {
+            declare_index(metric_id);
+        }
+        return indexes.percentile(metric_id, q);
+    }
+
+    double metric_percentile_rank(int metric_id, double value) {
+        if (!indexes.has_index(metric_id)) {
+            declare_index(metric_id);
+        }
+        return indexes.percentile_rank(metric_id, value);
+    }
+
+    void screen(Vector<MetricPredicate>& predicates, bool match_all, SelectionBitmap& out) {
+        out.resize(table.size());
+        if (predicates.size() == 0) {
+            return;
+        }
+        SelectionBitmap partial;
+        for (int p = 0; p < predicates.size(); ++p) {
+            MetricPredicate& pred = predicates[p];
+            SelectionBitmap& target = (p == 0) ? out : partial;
+            ScanKernels::filter(table.column(pred.metric), table.size(), pred.op, pred.low, pred.high, target);
+            if (p > 0) {
+                if (match_all) {
+                    out.and_with(partial);
+                } else {
+                    out.or_with(partial);
+                }
+            }
+        }
+    }
+
+    Vector<Stock*> screen(Vector<MetricPredicate>& predicates, bool match_all) {
+        SelectionBitmap selected;
+        screen(predicates, match_all, selected);
+        Vector<int> rows(selected.count() + 1);
+        selected.to_indices(rows);
+        Vector<Stock*> out(rows.size() + 1);
+        for (int i = 0; i < rows.size(); ++i) {
+            out.push_back(&all_stocks[rows[i]]);
+        }
+        return out;
+    }
+
+    Vector<Stock*> top_n_by_metric(int metric_id, int n, bool highest) {
         Vector<Stock*> out;
-        MaxHeap<StockRoeKey> copy = high_roe_heap;
-        int count = 0;
-        while (!copy.empty() && count < n) {
-            StockRoeKey k = copy.top();
-            copy.pop();
-            out.push_back(k.ref);
-            count++;
+        if (indexes.has_index(metric_id)) {
+            indexes.top_n(metric_id, n, highest, out);
+            return out;
+        }
+        if (n <= 0) {
+            return out;
+        }
+        if (highest) {
+            MinHeap<MetricKey> kept;
+            select_top_n(kept, metric_id, n, true);
+            drain_reversed(kept, out);
+        } else {
+            MaxHeap<MetricKey> kept;
+            select_top_n(kept, metric_id, n, false);
+            drain_reversed(kept, out);
+        }
+        return out;
+    }
+
+    Vector<Stock*> top_n_roe(int n) {
+        if (indexes.has_index(METRIC_ROE)) {
+            return top_n_by_metric(METRIC_ROE, n, true);
+        }
+        rebuild_heaps_if_dirty();
+        Vector<StockRoeKey> keys(n > 0 ? n : 1);
+        high_roe_heap.top_k(n, keys);
+        Vector<Stock*> out(keys.size() + 1);
+        for (int i = 0; i < keys.size(); ++i) {
+            out.push_back(keys[i].ref);
         }
         return out;
     }
 
     Vector<Stock*> lowest_n_pe(int n) {
-        Vector<Stock*> out;
-        MinHeap<StockPeKey> copy = low_pe_heap;
-        int count = 0;
-        while (!copy.empty() && count < n) {
-            StockPeKey k = copy.top();
-            copy.pop();
-            out.push_back(k.ref);
-            count++;
+        if (indexes.has_index(METRIC_PE)) {
+            return top_n_by_metric(METRIC_PE, n, false);
+        }
+        rebuild_heaps_if_dirty();
+        Vector<StockPeKey> keys(n > 0 ? n : 1);
+        low_pe_heap.top_k(n, keys);
+        Vector<Stock*> out(keys.size() + 1);
+        for (int i = 0; i < keys.size(); ++i) {
+            out.push_back(keys[i].ref);
         }
         return out;
     }
 
     void sort_by_metric(Vector<Stock*>& arr, int metric_id) {
+        if (indexes.has_index(metric_id) && arr.size() * INDEX_SORT_RATIO >= all_stocks.size()) {
+            if (sort_via_index(arr, metric_id)) {
+                return;
+            }
+        }
         quick_sort(arr, 0, arr.size() - 1, metric_id);
     }
 
@@ -214,94 +586,111 @@ public:
         double avg_pe;
         double avg_roe;
         double avg_div_yield;
+        double stddev_pe;
+        double stddev_roe;
+        double stddev_div_yield;
         double min_price;
         double max_price;
         int count;
     };
 
     SectorStats sector_stats(const string& sector) {
+        return sector_stats_by_id(table.find_sector(sector));
+    }
+
+    SectorStats sector_stats_by_id(int sector_id) {
         SectorStats st;
         st.avg_pe = 0.0;
         st.avg_roe = 0.0;
         st.avg_div_yield = 0.0;
+        st.stddev_pe = 0.0;
+        st.stddev_roe = 0.0;
+        st.stddev_div_yield = 0.0;
         st.min_price = 1e18;
         st.max_price = -1e18;
         st.count = 0;
+        if (!sector_cache.has_sector(sector_id)) {
+            return st;
+        }
+        SectorAggregate& agg = sector_cache.get(sector_id, table);
+        st.count = agg.count;
+        st.avg_pe = agg.mean_pe();
+        st.avg_roe = agg.mean_roe();
+        st.avg_div_yield = agg.mean_div();
+        st.stddev_pe = SectorAggregate::stddev(agg.sum_pe, agg.sum_pe_sq, agg.count);
+        st.stddev_roe = SectorAggregate::stddev(agg.sum_roe, agg.sum_roe_sq, agg.count);
+        st.stddev_div_yield = SectorAggregate::stddev(agg.sum_div, agg.sum_div_sq, agg.count);
+        st.min_price = agg.min_price;
+        st.max_price = agg.max_price;
+        return st;
+    }
 
-        string key = normalize_key(sector);
-        double sum_pe = 0.0;
-        double sum_roe = 0.0;
-        double sum_div = 0.0;
-
-        for (int i = 0; i < all_stocks.size(); ++i) {
-            string stock_key = normalize_key(all_stocks[i].sector);
-            if (stock_key == key) {
-                Stock* s = &all_stocks[i];
-                sum_pe = sum_pe + s->pe;
-                sum_roe = sum_roe + s->roe;
-                sum_div = sum_div + s->dividend_yield;
-                if (s->price < st.min_price) {
-                    st.min_price = s->price;
-                }
-                if (s->price > st.max_price) {
-                    st.max_price = s->price;
-                }
-                st.count = st.count + 1;
-            }
+    int sector_flags(Stock* s) {
+        if (s == nullptr || s->sector_id == NO_SECTOR) {
+            return SECTOR_NO_DATA;
         }
+        return sector_cache.flags(s->sector_id, s->pe, s->roe, s->dividend_yield);
+    }
 
-        if (st.count > 0) {
-            st.avg_pe = sum_pe / (double)st.count;
-            st.avg_roe = sum_roe / (double)st.count;
-            st.avg_div_yield = sum_div / (double)st.count;
-        }
-        return st;
+    void compare_all_vs_sector(Vector<int>& flags_out) {
+        sector_cache.flag_rows(table, flags_out);
     }
 
-    string compare_vs_sector(Stock* s) {
-        if (s == nullptr) {
-            return "No stock";
+    void compare_all_vs_sector(Vector<Stock*>& rows, Vector<int>& flags_out) {
+        flags_out.clear();
+        flags_out.reserve(rows.size() + 1);
+        for (int i = 0; i < rows.size(); ++i) {
+            flags_out.push_back(sector_flags(rows[i]));
         }
-        SectorStats st = sector_stats(s->sector);
-        if (st.count == 0) {
+    }
+
+    string describe_sector_flags(int flags) {
+        if (flags & SECTOR_NO_DATA) {
             return "Sector data unavailable";
         }
         string res = "";
         res += "P/E: ";
-        if (s->pe < st.avg_pe) {
-            res += "below sector avg; ";
-        } else {
-            res += "above sector avg; ";
-        }
+        res += (flags & SECTOR_PE_BELOW) ? "below sector avg; " : "above sector avg; ";
         res += "ROE: ";
-        if (s->roe < st.avg_roe) {
-            res += "below sector avg; ";
-        } else {
-            res += "above sector avg; ";
-        }
+        res += (flags & SECTOR_ROE_BELOW) ? "below sector avg; " : "above sector avg; ";
         res += "Dividend Yield: ";
-        if (s->dividend_yield < st.avg_div_yield) {
-            res += "below sector avg";
-        } else {
-            res += "above sector avg";
-        }
+        res += (flags & SECTOR_DIV_BELOW) ? "below sector avg" : "above sector avg";
         return res;
     }
 
+    string compare_vs_sector(Stock* s) {
+        if (s == nullptr) {
+            return "No stock";
+        }
+        return describe_sector_flags(sector_flags(s));
+    }
+
     struct RecScore {
         double score;
         Stock* ref;
         bool operator<(const RecScore& other) {
-            if (score == other.score) {
+            if (score != other.score) {
+                return score < other.score;
+            }
+            if (ref->company_name != other.ref->company_name) {
                 return ref->company_name < other.ref->company_name;
             }
-            return score < other.score;
+            if (ref->year != other.ref->year) {
+                return ref->year < other.ref->year;
+            }
+            return ref < other.ref;
         }
         bool operator>(const RecScore& other) {
-            if (score == other.score) {
+            if (score != other.score) {
+                return score > other.score;
+            }
+            if (ref->company_name != other.ref->company_name) {
                 return ref->company_name > other.ref->company_name;
             }
-            return score > other.score;
+            if (ref->year != other.ref->year) {
+                return ref->year > other.ref->year;
+            }
+            return ref > other.ref;
         }
         bool operator<=(const RecScore& other) {
             return !(*this > other);
@@ -314,62 +703,49 @@ public:
         }
     };
 
-    Vector<Stock*> recommend(int strategy_id, int top_n) {
-        double w_value = 0.25;
-        double w_growth = 0.25;
-        double w_health = 0.25;
-        double w_div = 0.25;
-        if (strategy_id == 0) {
-            w_growth = 0.5;
-            w_value = 0.1;
-            w_health = 0.2;
-            w_div = 0.2;
-        }
-        if (strategy_id == 1) {
-            w_value = 0.5;
-            w_growth = 0.15;
-            w_health = 0.2;
-            w_div = 0.15;
+    Vector<Stock*> recommend(int strategy_id, int top_n, bool latest_only = false) {
+        RecWeights w = recommend_weights(strategy_id);
+        Vector<Stock*> out;
+        if (top_n <= 0) {
+            return out;
         }
-        if (strategy_id == 2) {
-            w_div = 0.5;
-            w_value = 0.2;
-            w_growth = 0.1;
-            w_health = 0.2;
-        }
-        if (strategy_id == 3) {
-            w_value = 0.25;
-            w_growth = 0.25;
-            w_health = 0.25;
-            w_div = 0.25;
-        }
-        MaxHeap<RecScore> heap;
-        for (int i = 0; i < all_stocks.size(); ++i) {
-            Stock* s = &all_stocks[i];
-            double value_score = 0.0;
-            if (s->pe > 0.0) {
-                value_score = 1.0 / s->pe;
-            }
-            double growth_score = s->expected_growth;
-            double health_score = (s->roe * 0.5) + (s->equity_to_asset * 0.5);
-            double dividend_score = 0.0;
-            if (s->price > 0.0) {
-                dividend_score = s->dividend_yield;
-            }
-            double total = w_value * value_score + w_growth * growth_score + w_health * health_score + w_div * dividend_score;
-            RecScore r;
-            r.score = total;
-            r.ref = s;
-            heap.push(r);
+        Vector<int> rows;
+        int count = recommend_candidates(latest_only, rows);
+        if (count == 0) {
+            return out;
         }
+        MinHeap<RecScore> kept;
+        score_rows(w, latest_only ? &rows[0] : nullptr, 0, count, top_n, kept);
+        drain_reversed(kept, out);
+        return out;
+    }
+
+    Vector<Stock*> recommend_parallel(int strategy_id, int top_n, bool latest_only = false, int num_threads = 0) {
+        RecWeights w = recommend_weights(strategy_id);
         Vector<Stock*> out;
-        int count = 0;
-        while (!heap.empty() && count < top_n) {
-            RecScore r = heap.top();
-            heap.pop();
-            out.push_back(r.ref);
-            count++;
+        if (top_n <= 0) {
+            return out;
+        }
+        Vector<int> rows;
+        int count = recommend_candidates(latest_only, rows);
+        if (count == 0) {
+            return out;
         }
+        int* row_ptr = latest_only ? &rows[0] : nullptr;
+        int n = Parallel::clamp_threads(num_threads, count / REC_MIN_ROWS_PER_THREAD + 1);
+        MinHeap<RecScore>* parts = new MinHeap<RecScore>[n];
+        Parallel::for_each_range(count, n, [&](int worker, int begin, int end) {
+            score_rows(w, row_ptr, begin, end, top_n, parts[worker]);
+        });
+        MinHeap<RecScore> kept;
+        for (int t = 0; t < n; ++t) {
+            while (!parts[t].empty()) {
+                offer(kept, parts[t].top(), top_n);
+                parts[t].pop();
+            }
+        }
+        delete[] parts;
+        drain_reversed(kept, out);
         return out;
     }
 
@@ -405,36 +781,122 @@ public:
         if (index < 0 || index >= all_stocks.size()) {
             return out;
         }
-        Vector<Stock*> temp;
-        for (int i = 0; i < all_stocks.size(); ++i) {
-            if (i == index) {
-                continue;
-            }
-            temp.push_back(&all_stocks[i]);
-        }
-        Vector<double> dists;
-        for (int i = 0; i < temp.size(); ++i) {
-            double dist = distance_between(&all_stocks[index], temp[i]);
-            dists.push_back(dist);
-        }
-        for (int i = 0; i < temp.size() - 1; ++i) {
-            for (int j = i + 1; j < temp.size(); ++j) {
-                if (dists[i] > dists[j]) {
-                    double td = dists[i];
-                    dists[i] = dists[j];
-                    dists[j] = td;
-                    Stock* ts = temp[i];
-                    temp[i] = temp[j];
-                    temp[j] = ts;
+        rebuild_features_if_dirty();
+        double query[SIMILARITY_DIMS];
+        feature_vector(index, query);
+        Vector<KdNeighbor> found;
+        feature_tree.knn(query, k, index, found);
+        for (int i = 0; i < found.size(); ++i) {
+            out.push_back(&all_stocks[found[i].id]);
+        }
+        return out;
+    }
+
+    void similar_batch(Vector<int>& indices, int k, Vector<int>& neighbors_out, int num_threads = 0) {
+        neighbors_out.clear();
+        int count = indices.size();
+        if (k <= 0 || count == 0) {
+            return;
+        }
+        rebuild_features_if_dirty();
+        neighbors_out.reserve(count * k + 1);
+        for (int i = 0; i < count * k; ++i) {
+            neighbors_out.push_back(-1);
+        }
+        int n = Parallel::clamp_threads(num_threads, count / KNN_MIN_QUERIES_PER_THREAD + 1);
+        Parallel::for_each_range(count, n, [&](int, int begin, int end) {
+            Vector<KdNeighbor> found(k + 1);
+            double query[SIMILARITY_DIMS];
+            for (int q = begin; q < end; ++q) {
+                int row = indices[q];
+                if (row < 0 || row >= table.size()) {
+                    continue;
+                }
+                feature_vector(row, query);
+                feature_tree.knn(query, k, row, found);
+                for (int j = 0; j < found.size(); ++j) {
+                    neighbors_out[q * k + j] = found[j].id;
                 }
             }
+        });
+    }
+
+    int peer_group_id(int index) {
+        if (index < 0 || index >= all_stocks.size()) {
+            return -1;
+        }
+        rebuild_clusters_if_dirty();
+        return peer_clusters.community(index);
+    }
+
+    Vector<Stock*> peer_group(int index) {
+        Vector<Stock*> out;
+        int group = peer_group_id(index);
+        if (group < 0) {
+            return out;
         }
-        for (int i = 0; i < temp.size() && i < k; ++i) {
-            out.push_back(temp[i]);
+        CsrGraph::Span members = peer_clusters.members(group);
+        out.reserve(members.size() + 1);
+        for (int i = 0; i < members.size(); ++i) {
+            if (members[i] != index) {
+                out.push_back(&all_stocks[members[i]]);
+            }
         }
         return out;
     }
 
+    struct PeerValuation {
+        int group;
+        int peers;
+        double avg_pe;
+        double avg_roe;
+        double avg_div_yield;
+        double pe_premium;
+        double roe_premium;
+        double div_yield_premium;
+    };
+
+    PeerValuation peer_valuation(int index) {
+        PeerValuation v;
+        v.group = peer_group_id(index);
+        v.peers = 0;
+        v.avg_pe = 0.0;
+        v.avg_roe = 0.0;
+        v.avg_div_yield = 0.0;
+        v.pe_premium = 0.0;
+        v.roe_premium = 0.0;
+        v.div_yield_premium = 0.0;
+        if (v.group < 0) {
+            return v;
+        }
+        fill_peer_valuation(index, v);
+        return v;
+    }
+
+    void peer_valuation_all(Vector<PeerValuation>& out) {
+        out.clear();
+        int n = table.size();
+        out.reserve(n + 1);
+        rebuild_clusters_if_dirty();
+        for (int i = 0; i < n; ++i) {
+            PeerValuation v;
+            v.group = peer_clusters.community(i);
+            fill_peer_valuation(i, v);
+            out.push_back(v);
+        }
+    }
+
+    string describe_peer_valuation(PeerValuation& v) {
+        if (v.peers == 0) {
+            return "No peers in cluster";
+        }
+        string res = "Peers: " + to_string(v.peers) + "; ";
+        res += "P/E: " + to_string(v.pe_premium * 100.0) + "% vs peers; ";
+        res += "ROE: " + to_string(v.roe_premium * 100.0) + "% vs peers; ";
+        res += "Dividend Yield: " + to_string(v.div_yield_premium * 100.0) + "% vs peers";
+        return res;
+    }
+
     LinearRegression<double> train_linear_regression(
         Vector<int>& feature_indices,
         Vector<Stock*>& dataset,
@@ -453,161 +915,339 @@ public:
         latest_indices_out.clear();
         preds_out.clear();
 
+        LinearRegression<double> lr;
         if (total == 0) {
-            LinearRegression<double> lr_empty;
-            return lr_empty;
+            return lr;
         }
+        forecast_company_trends(dataset, latest_indices_out, preds_out);
 
-        Vector<string> seen_names;
-        Vector<double> all_true;
-        Vector<double> all_pred;
+        int m = feature_indices.size();
+        if (m == 0) {
+            return lr;
+        }
+        Vector<double*> feature_cols(m + 1);
+        for (int j = 0; j < m; ++j) {
+            if (feature_indices[j] == METRIC_PRICE) {
+                throw "Price is the regression target and cannot be a feature";
+            }
+            feature_cols.push_back(table.column(feature_indices[j]));
+        }
 
+        int train_count = (int)((double)total * train_ratio);
+        if (train_count <= 0 || train_count > total) {
+            train_count = total;
+        }
+        int test_count = total - train_count;
+        int* rows = new int[total + 1];
         for (int i = 0; i < total; ++i) {
-            Stock* s = dataset[i];
-            string name = s->company_name;
-            bool exists = false;
-            for (int k = 0; k < seen_names.size(); ++k) {
-                if (seen_names[k] == name) {
-                    exists = true;
-                    break;
-                }
+            rows[i] = (int)(dataset[i] - &all_stocks[0]);
+        }
+        double* price = table.column(METRIC_PRICE);
+        Matrix<double> X_train(train_count, m);
+        Matrix<double> X_test(test_count, m);
+        Vector<double> y_train(train_count + 1);
+        Vector<double> y_test(test_count + 1);
+        for (int j = 0; j < m; ++j) {
+            double* col = feature_cols[j];
+            for (int i = 0; i < train_count; ++i) {
+                X_train[i][j] = col[rows[i]];
             }
-            if (exists) {
-                continue;
+            for (int i = 0; i < test_count; ++i) {
+                X_test[i][j] = col[rows[train_count + i]];
             }
-            seen_names.push_back(name);
+        }
+        for (int i = 0; i < train_count; ++i) {
+            y_train.push_back(price[rows[i]]);
+        }
+        for (int i = 0; i < test_count; ++i) {
+            y_test.push_back(price[rows[train_count + i]]);
+        }
+        delete[] rows;
 
-            Vector<Stock*> series;
-            for (int j = 0; j < total; ++j) {
-                if (dataset[j]->company_name == name) {
-                    series.push_back(dataset[j]);
-                }
-            }
+        lr.fit(X_train, y_train);
+        if (test_count > 0) {
+            Vector<double> y_pred = lr.predict(X_test);
+            r2_out = lr.r_squared(y_test, y_pred);
+            mse_out = lr.mean_squared_error(y_test, y_pred);
+            mae_out = lr.mean_absolute_error(y_test, y_pred);
+        } else {
+            Vector<double> y_pred = lr.predict(X_train);
+            r2_out = lr.r_squared(y_train, y_pred);
+            mse_out = lr.mean_squared_error(y_train, y_pred);
+            mae_out = lr.mean_absolute_error(y_train, y_pred);
+        }
+        rmse_out = sqrt(mse_out);
+        return lr;
+    }
 
-            int len = series.size();
-            for (int a = 0; a < len - 1; ++a) {
-                for (int b = a + 1; b < len; ++b) {
-                    if (series[b]->year < series[a]->year) {
-                        Stock* tmp = series[a];
-                        series[a] = series[b];
-                        series[b] = tmp;
-                    }
-                }
+    void forecast_company_trends(Vector<Stock*>& dataset, Vector<int>& latest_indices_out, Vector<double>& preds_out, int num_threads = 0) {
+        latest_indices_out.clear();
+        preds_out.clear();
+        rebuild_series_if_dirty();
+        int total = dataset.size();
+        bool* member = new bool[table.size() + 1];
+        for (int i = 0; i < table.size(); ++i) {
+            member[i] = false;
+        }
+        int distinct = 0;
+        for (int i = 0; i < total; ++i) {
+            int row = (int)(dataset[i] - &all_stocks[0]);
+            if (!member[row]) {
+                member[row] = true;
+                distinct++;
             }
-
-            if (len < 2) {
+        }
+        CompanyTrendKernel subset;
+        CompanyTrendKernel* kernel = &subset;
+        if (distinct == table.size()) {
+            kernel = &company_trends(num_threads);
+        } else {
+            subset.build(series_index, table.years(), table.column(METRIC_PRICE), num_threads, member);
+        }
+        latest_indices_out.reserve(kernel->company_count() + 1);
+        preds_out.reserve(kernel->company_count() + 1);
+        for (int c = 0; c < kernel->company_count(); ++c) {
+            if (kernel->points(c) < 2) {
                 continue;
             }
+            latest_indices_out.push_back(kernel->latest_row(c));
+            preds_out.push_back(kernel->forecast(c));
+        }
+        delete[] member;
+    }
 
-            double sum_x = 0.0;
-            double sum_y = 0.0;
-            double sum_xx = 0.0;
-            double sum_xy = 0.0;
-            for (int t = 0; t < len; ++t) {
-                double x = (double)series[t]->year;
-                double y = series[t]->price;
-                sum_x = sum_x + x;
-                sum_y = sum_y + y;
-                sum_xx = sum_xx + x * x;
-                sum_xy = sum_xy + x * y;
-            }
-
-            double n = (double)len;
-            double denom = n * sum_xx - sum_x * sum_x;
-            double slope = 0.0;
-            double intercept = 0.0;
-            if (denom != 0.0) {
-                slope = (n * sum_xy - sum_x * sum_y) / denom;
-                intercept = (sum_y - slope * sum_x) / n;
-            } else {
-                intercept = sum_y / n;
-                slope = 0.0;
-            }
+private:
+    static const int KEY_BUFFER_SIZE = 128;
+    static const int KNN_MIN_QUERIES_PER_THREAD = 256;
+    static const int GRAPH_MIN_ROWS_PER_THREAD = 2048;
+    static const int REC_MIN_ROWS_PER_THREAD = 4096;
+    static const int INDEX_SORT_RATIO = 8;
+    static constexpr double SIMILARITY_THRESHOLD = 0.3;
 
-            for (int t = 0; t < len; ++t) {
-                double x = (double)series[t]->year;
-                double y = series[t]->price;
-                double y_hat = intercept + slope * x;
-                all_true.push_back(y);
-                all_pred.push_back(y_hat);
-            }
+    bool heaps_dirty_;
+    bool series_dirty_;
+    bool features_dirty_;
+    bool graph_dirty_;
+    bool clusters_dirty_;
+    bool trend_kernel_dirty_;
+    Vector<PeerAggregate> peer_aggregates_;
 
-            Stock* latest = series[len - 1];
-            double next_year = (double)(latest->year + 1);
-            double next_price = intercept + slope * next_year;
+    void similarity_columns(double** columns) {
+        columns[0] = table.column(METRIC_PE);
+        columns[1] = table.column(METRIC_ROE);
+        columns[2] = table.column(METRIC_BOOK_VALUE);
+        columns[3] = table.column(METRIC_LATEST_EPS);
+        columns[4] = table.column(METRIC_DIVIDEND_YIELD);
+    }
 
-            int idx_latest = (int)(latest - &all_stocks[0]);
-            latest_indices_out.push_back(idx_latest);
-            preds_out.push_back(next_price);
+    void feature_vector(int row, double* out) {
+        double* columns[SIMILARITY_DIMS];
+        similarity_columns(columns);
+        for (int d = 0; d < SIMILARITY_DIMS; ++d) {
+            out[d] = columns[d][row];
         }
+    }
 
-        int n_points = all_true.size();
-        if (n_points == 0) {
-            LinearRegression<double> lr_none;
-            return lr_none;
+    void rebuild_features_if_dirty() {
+        if (!features_dirty_) {
+            return;
         }
+        double* columns[SIMILARITY_DIMS];
+        similarity_columns(columns);
+        feature_tree.build(columns, table.size());
+        features_dirty_ = false;
+    }
 
-        double sum_y = 0.0;
-        for (int i = 0; i < n_points; ++i) {
-            sum_y = sum_y + all_true[i];
+    void rebuild_series_if_dirty() {
+        if (!series_dirty_) {
+            return;
         }
-        double mean_y = sum_y / (double)n_points;
+        series_index.build(table.company_ids(), table.years(), table.size(), table.company_count());
+        series_dirty_ = false;
+    }
 
-        double ss_res = 0.0;
-        double ss_tot = 0.0;
-        double sum_abs = 0.0;
-        for (int i = 0; i < n_points; ++i) {
-            double err = all_true[i] - all_pred[i];
-            ss_res = ss_res + err * err;
-            if (err < 0.0) {
-                sum_abs = sum_abs - err;
-            } else {
-                sum_abs = sum_abs + err;
-            }
-            double diff_tot = all_true[i] - mean_y;
-            ss_tot = ss_tot + diff_tot * diff_tot;
+    Vector<Stock*> all_ptrs() {
+        Vector<Stock*> v(all_stocks.size() + 1);
+        for (int i = 0; i < all_stocks.size(); ++i) {
+            v.push_back(&all_stocks[i]);
         }
+        return v;
+    }
 
-        if (ss_tot == 0.0) {
-            r2_out = 1.0;
-        } else {
-            r2_out = 1.0 - (ss_res / ss_tot);
+    void rebuild_heaps_if_dirty() {
+        if (!heaps_dirty_) {
+            return;
         }
-        mse_out = ss_res / (double)n_points;
-        rmse_out = sqrt(mse_out);
-        mae_out = sum_abs / (double)n_points;
+        low_pe_heap = MinHeap<StockPeKey>();
+        high_roe_heap = MaxHeap<StockRoeKey>();
+        for (int i = 0; i < all_stocks.size(); ++i) {
+            StockPeKey pe_key;
+            pe_key.ref = &all_stocks[i];
+            low_pe_heap.push(pe_key);
+            StockRoeKey roe_key;
+            roe_key.ref = &all_stocks[i];
+            high_roe_heap.push(roe_key);
+        }
+        heaps_dirty_ = false;
+    }
+
+    struct RecWeights {
+        double value;
+        double growth;
+        double health;
+        double div;
+    };
+
+    RecWeights recommend_weights(int strategy_id) {
+        RecWeights w;
+        w.value = 0.25;
+        w.growth = 0.25;
+        w.health = 0.25;
+        w.div = 0.25;
+        if (strategy_id == 0) {
+            w.growth = 0.5;
+            w.value = 0.1;
+            w.health = 0.2;
+            w.div = 0.2;
+        }
+        if (strategy_id == 1) {
+            w.value = 0.5;
+            w.growth = 0.15;
+            w.health = 0.2;
+            w.div = 0.15;
+        }
+        if (strategy_id == 2) {
+            w.div = 0.5;
+            w.value = 0.2;
+            w.growth = 0.1;
+            w.health = 0.2;
+        }
+        return w;
+    }
 
-        LinearRegression<double> lr_dummy;
-        return lr_dummy;
+    int recommend_candidates(bool latest_only, Vector<int>& rows) {
+        int total = table.size();
+        if (!latest_only) {
+            return total;
+        }
+        int companies = table.company_count();
+        int* ids = table.company_ids();
+        int* years = table.years();
+        int* latest = new int[companies + 1];
+        for (int c = 0; c < companies; ++c) {
+            latest[c] = -1;
+        }
+        for (int i = 0; i < total; ++i) {
+            int c = ids[i];
+            if (latest[c] < 0 || years[i] > years[latest[c]]) {
+                latest[c] = i;
+            }
+        }
+        rows.reserve(companies + 1);
+        for (int c = 0; c < companies; ++c) {
+            if (latest[c] >= 0) {
+                rows.push_back(latest[c]);
+            }
+        }
+        delete[] latest;
+        return rows.size();
     }
 
-private:
-    double feature_value(Stock* s, int id) {
-        if (id == 0) {
-            return s->latest_eps;
+    void score_rows(RecWeights& w, int* rows, int begin, int end, int top_n, MinHeap<RecScore>& kept) {
+        double* pe_col = table.column(METRIC_PE);
+        double* growth_col = table.column(METRIC_EXPECTED_GROWTH);
+        double* roe_col = table.column(METRIC_ROE);
+        double* equity_col = table.column(METRIC_EQUITY_TO_ASSET);
+        double* price_col = table.column(METRIC_PRICE);
+        double* div_col = table.column(METRIC_DIVIDEND_YIELD);
+        for (int k = begin; k < end; ++k) {
+            int i = rows != nullptr ? rows[k] : k;
+            double value_score = 0.0;
+            if (pe_col[i] > 0.0) {
+                value_score = 1.0 / pe_col[i];
+            }
+            double growth_score = growth_col[i];
+            double health_score = (roe_col[i] * 0.5) + (equity_col[i] * 0.5);
+            double dividend_score = 0.0;
+            if (price_col[i] > 0.0) {
+                dividend_score = div_col[i];
+            }
+            RecScore r;
+            r.score = w.value * value_score + w.growth * growth_score + w.health * health_score + w.div * dividend_score;
+            r.ref = &all_stocks[i];
+            offer(kept, r, top_n);
         }
-        if (id == 1) {
-            return s->pe;
+    }
+
+    void offer(MinHeap<RecScore>& kept, RecScore r, int top_n) {
+        if (kept.size() < top_n) {
+            kept.push(r);
+        } else if (r > kept.top()) {
+            kept.pop();
+            kept.push(r);
         }
-        if (id == 2) {
-            return s->book_value;
+    }
+
+    template<typename Heap>
+    void select_top_n(Heap& kept, int metric_id, int n, bool highest) {
+        double* col = table.column(metric_id);
+        for (int i = 0; i < table.size(); ++i) {
+            MetricKey key;
+            key.value = col[i];
+            key.ref = &all_stocks[i];
+            if (kept.size() < n) {
+                kept.push(key);
+            } else if (highest ? key > kept.top() : key < kept.top()) {
+                kept.pop();
+                kept.push(key);
+            }
         }
-        if (id == 3) {
-            return s->roe;
+    }
+
+    template<typename Heap>
+    void drain_reversed(Heap& kept, Vector<Stock*>& out) {
+        int count = kept.size();
+        int start = out.size();
+        for (int i = 0; i < count; ++i) {
+            out.push_back(nullptr);
         }
-        if (id == 4) {
-            return s->last_dividend;
+        for (int i = count - 1; i >= 0; --i) {
+            out[start + i] = kept.top().ref;
+            kept.pop();
         }
-        if (id == 5) {
-            return s->price;
+    }
+
+    bool sort_via_index(Vector<Stock*>& arr, int metric_id) {
+        int n = all_stocks.size();
+        if (n == 0) {
+            return false;
         }
-        if (id == 6) {
-            return s->expected_growth;
+        Stock* base = &all_stocks[0];
+        unsigned char* marks = new unsigned char[n]();
+        for (int i = 0; i < arr.size(); ++i) {
+            long long row = arr[i] - base;
+            if (row < 0 || row >= n) {
+                delete[] marks;
+                return false;
+            }
+            if (marks[row] < 255) {
+                marks[row]++;
+            }
         }
-        if (id == 7) {
-            return s->dividend_yield;
+        int pos = 0;
+        AVLTree<MetricKey>& tree = indexes.index(metric_id);
+        for (AVLTree<MetricKey>::Iterator it = tree.begin(); it.valid(); ++it) {
+            long long row = it->ref - base;
+            for (int c = 0; c < marks[row]; ++c) {
+                arr[pos++] = it->ref;
+            }
         }
-        return 0.0;
+        delete[] marks;
+        return true;
+    }
+
+    double feature_value(Stock* s, int id) {
+        return s->metric_value(id);
     }
 
     void quick_sort(Vector<Stock*>& arr, int l, int r, int metric_id) {
@@ -640,35 +1280,118 @@ private:
         }
     }
 
-    void build_similarity_graph() {
-        similarity_graph = AdjacencyListGraph<int>(false, all_stocks.size());
-        for (int i = 0; i < all_stocks.size(); ++i) {
-            similarity_graph.set_vertex_data(i, i);
-        }
-        double threshold = 0.3;
-        for (int i = 0; i < all_stocks.size(); ++i) {
-            for (int j = i + 1; j < all_stocks.size(); ++j) {
-                double dist = distance_between(&all_stocks[i], &all_stocks[j]);
-                if (dist < threshold) {
-                    similarity_graph.add_edge(i, j);
+    void build_similarity_graph(int num_threads = 0) {
+        rebuild_features_if_dirty();
+        int count = table.size();
+        int n = Parallel::clamp_threads(num_threads, count / GRAPH_MIN_ROWS_PER_THREAD + 1);
+        double limit_sq = similarity_limit_sq();
+        Vector<int>* degrees = new Vector<int>[n];
+        Vector<int>* targets = new Vector<int>[n];
+        Parallel::for_each_range(count, n, [&](int worker, int begin, int end) {
+            double query[SIMILARITY_DIMS];
+            Vector<int>& row_degrees = degrees[worker];
+            Vector<int>& row_targets = targets[worker];
+            row_degrees.reserve(end - begin + 1);
+            int* scratch = nullptr;
+            int scratch_size = 0;
+            for (int i = begin; i < end; ++i) {
+                int start = row_targets.size();
+                feature_vector(i, query);
+                feature_tree.radius(query, SIMILARITY_THRESHOLD, [&](int j, double dist_sq) {
+                    if (j != i && dist_sq < limit_sq) {
+                        row_targets.push_back(j);
+                    }
+                });
+                int found = row_targets.size() - start;
+                if (found > scratch_size) {
+                    delete[] scratch;
+                    scratch_size = found * 2;
+                    scratch = new int[scratch_size];
+                }
+                if (found > 1) {
+                    CsrGraph::sort_targets(&row_targets[start], found, scratch, count);
                 }
+                row_degrees.push_back(found);
             }
+            delete[] scratch;
+        });
+        similarity_graph.assemble(count, degrees, targets, n, false);
+        delete[] degrees;
+        delete[] targets;
+        graph_dirty_ = false;
+    }
+
+    static double similarity_limit_sq() {
+        double limit = SIMILARITY_THRESHOLD * SIMILARITY_THRESHOLD;
+        while (sqrt(limit) < SIMILARITY_THRESHOLD) {
+            limit = nextafter(limit, 1e300);
+        }
+        while (sqrt(nextafter(limit, 0.0)) >= SIMILARITY_THRESHOLD) {
+            limit = nextafter(limit, 0.0);
         }
+        return limit;
     }
 
-    double distance_between(Stock* a, Stock* b) {
-        double sum = 0.0;
-        sum += diff_sq(a->pe, b->pe);
-        sum += diff_sq(a->roe, b->roe);
-        sum += diff_sq(a->book_value, b->book_value);
-        sum += diff_sq(a->latest_eps, b->latest_eps);
-        sum += diff_sq(a->dividend_yield, b->dividend_yield);
-        return sqrt(sum);
+    void rebuild_graph_if_dirty() {
+        if (graph_dirty_) {
+            build_similarity_graph();
+        }
+    }
+
+    void rebuild_clusters_if_dirty() {
+        if (!clusters_dirty_ && !graph_dirty_) {
+            return;
+        }
+        rebuild_graph_if_dirty();
+        peer_clusters.build(similarity_graph);
+        peer_aggregates_.clear();
+        peer_aggregates_.reserve(peer_clusters.community_count() + 1);
+        for (int c = 0; c < peer_clusters.community_count(); ++c) {
+            peer_aggregates_.push_back(PeerAggregate());
+        }
+        int* group_col = peer_clusters.communities();
+        double* pe_col = table.column(METRIC_PE);
+        double* roe_col = table.column(METRIC_ROE);
+        double* div_col = table.column(METRIC_DIVIDEND_YIELD);
+        for (int i = 0; i < table.size(); ++i) {
+            PeerAggregate& agg = peer_aggregates_[group_col[i]];
+            agg.count++;
+            agg.sum_pe += pe_col[i];
+            agg.sum_roe += roe_col[i];
+            agg.sum_div += div_col[i];
+        }
+        clusters_dirty_ = false;
     }
 
-    double diff_sq(double x, double y) {
-        double d = x - y;
-        return d * d;
+    static double relative_premium(double value, double peer_mean) {
+        if (peer_mean == 0.0) {
+            return 0.0;
+        }
+        return (value - peer_mean) / fabs(peer_mean);
+    }
+
+    void fill_peer_valuation(int row, PeerValuation& v) {
+        PeerAggregate& agg = peer_aggregates_[v.group];
+        double pe = table.column(METRIC_PE)[row];
+        double roe = table.column(METRIC_ROE)[row];
+        double div = table.column(METRIC_DIVIDEND_YIELD)[row];
+        v.peers = agg.count - 1;
+        if (v.peers <= 0) {
+            v.peers = 0;
+            v.avg_pe = 0.0;
+            v.avg_roe = 0.0;
+            v.avg_div_yield = 0.0;
+            v.pe_premium = 0.0;
+            v.roe_premium = 0.0;
+            v.div_yield_premium = 0.0;
+            return;
+        }
+        v.avg_pe = (agg.sum_pe - pe) / (double)v.peers;
+        v.avg_roe = (agg.sum_roe - roe) / (double)v.peers;
+        v.avg_div_yield = (agg.sum_div - div) / (double)v.peers;
+        v.pe_premium = relative_premium(pe, v.avg_pe);
+        v.roe_premium = relative_premium(roe, v.avg_roe);
+        v.div_yield_premium = relative_premium(div, v.avg_div_yield);
     }
 };
 
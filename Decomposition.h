@@ -0,0 +1,427 @@
+#ifndef DECOMPOSITION_H
+#define DECOMPOSITION_H
+
+#include "Matrix.h"
+#include "Vector.h"
+#include <cmath>
+
+using namespace std;
+
+template<typename T>
+class DecompositionOps {
+public:
+    static T abs_value(T v) {
+        return v < T(0) ? -v : v;
+    }
+
+    static T norm1(Matrix<T>& A) {
+        int n = A.rows();
+        T best = T(0);
+        for (int j = 0; j < A.cols(); ++j) {
+            T sum = T(0);
+            for (int i = 0; i < n; ++i) {
+                sum = sum + abs_value(A[i][j]);
+            }
+            if (sum > best) {
+                best = sum;
+            }
+        }
+        return best;
+    }
+
+    template<typename Solve, typename SolveTransposed>
+    static T inverse_norm1_estimate(int n, Solve solve, SolveTransposed solve_transposed) {
+        T* x = new T[n];
+        T* y = new T[n];
+        T* z = new T[n];
+        for (int i = 0; i < n; ++i) {
+            x[i] = T(1) / T(n);
+        }
+        T estimate = T(0);
+        for (int iter = 0; iter < 5; ++iter) {
+            solve(x, y);
+            estimate = T(0);
+            for (int i = 0; i < n; ++i) {
+                estimate = estimate + abs_value(y[i]);
+            }
+            for (int i = 0; i < n; ++i) {
+                y[i] = y[i] < T(0) ? T(-1) : T(1);
+            }
+            solve_transposed(y, z);
+            int best = 0;
+            T zx = T(0);
+            for (int i = 0; i < n; ++i) {
+                zx = zx + z[i] * x[i];
+                if (abs_value(z[i]) > abs_value(z[best])) {
+                    best = i;
+                }
+            }
+            if (iter > 0 && abs_value(z[best]) <= zx) {
+                break;
+            }
+            for (int i = 0; i < n; ++i) {
+                x[i] = T(0);
+            }
+            x[best] = T(1);
+        }
+        delete[] x;
+        delete[] y;
+        delete[] z;
+        return estimate;
+    }
+};
+
+template<typename T>
+class LuDecomposition {
+private:
+    Matrix<T> lu_;
+    int* pivots_;
+    int size_;
+    int sign_;
+    bool singular_;
+    T norm1_;
+
+    void check_solvable(int length) {
+        if (singular_) {
+            throw "Matrix is singular, cannot solve";
+        }
+        if (length != size_) {
+            throw "Right-hand side size must match matrix size";
+        }
+    }
+
+    void solve_transposed_raw(T* b, T* x) {
+        int n = size_;
+        T* w = new T[n];
+        for (int i = 0; i < n; ++i) {
+            T v = b[i];
+            for (int k = 0; k < i; ++k) {
+                v = v - lu_[k][i] * w[k];
+            }
+            w[i] = v / lu_[i][i];
+        }
+        for (int i = n - 1; i >= 0; --i) {
+            T v = w[i];
+            for (int k = i + 1; k < n; ++k) {
+                v = v - lu_[k][i] * w[k];
+            }
+            w[i] = v;
+        }
+        for (int i = 0; i < n; ++i) {
+            x[pivots_[i]] = w[i];
+        }
+        delete[] w;
+    }
+
+public:
+    explicit LuDecomposition(Matrix<T>& A) : lu_(), pivots_(nullptr), size_(0), sign_(1), singular_(false), norm1_(T(0)) {
+        factor(A);
+    }
+
+    LuDecomposition(const LuDecomposition& other) = delete;
+    LuDecomposition& operator=(const LuDecomposition& other) = delete;
+
+    ~LuDecomposition() {
+        delete[] pivots_;
+    }
+
+    void factor(Matrix<T>& A) {
+        if (!A.is_square()) {
+            throw "LU decomposition requires a square matrix";
+        }
+        lu_ = A;
+        size_ = A.rows();
+        delete[] pivots_;
+        pivots_ = new int[size_ + 1];
+        sign_ = 1;
+        singular_ = false;
+        norm1_ = DecompositionOps<T>::norm1(A);
+        int n = size_;
+        for (int i = 0; i < n; ++i) {
+            pivots_[i] = i;
+        }
+        for (int k = 0; k < n; ++k) {
+            int p = k;
+            T best = DecompositionOps<T>::abs_value(lu_[k][k]);
+            for (int i = k + 1; i < n; ++i) {
+                T v = DecompositionOps<T>::abs_value(lu_[i][k]);
+                if (v > best) {
+                    best = v;
+                    p = i;
+                }
+            }
+            if (best == T(0)) {
+                singular_ = true;
+                continue;
+            }
+            if (p != k) {
+                lu_.swap_rows(p, k);
+                int t = pivots_[p];
+                pivots_[p] = pivots_[k];
+                pivots_[k] = t;
+                sign_ = -sign_;
+            }
+            T* row_k = lu_[k];
+            T pivot = row_k[k];
+            for (int i = k + 1; i < n; ++i) {
+                T* row_i = lu_[i];
+                T factor = row_i[k] / pivot;
+                row_i[k] = factor;
+                if (factor == T(0)) {
+                    continue;
+                }
+                for (int j = k + 1; j < n; ++j) {
+                    row_i[j] = row_i[j] - factor * row_k[j];
+                }
+            }
+        }
+    }
+
+    int size() {
+        return size_;
+    }
+
+    bool is_singular() {
+        return singular_;
+    }
+
+    T determinant() {
+        if (singular_) {
+            return T(0);
+        }
+        T det = T(sign_);
+        for (int i = 0; i < size_; ++i) {
+            det = det * lu_[i][i];
+        }
+        return det;
+    }
+
+    void solve(T* b, T* x) {
+        check_solvable(size_);
+        int n = size_;
+        for (int i = 0; i < n; ++i) {
+            x[i] = b[pivots_[i]];
+        }
+        for (int i = 0; i < n; ++i) {
+            T* row = lu_[i];
+            T v = x[i];
+            for (int k = 0; k < i; ++k) {
+                v = v - row[k] * x[k];
+            }
+            x[i] = v;
+        }
+        for (int i = n - 1; i >= 0; --i) {
+            T* row = lu_[i];
+            T v = x[i];
+            for (int k = i + 1; k < n; ++k) {
+                v = v - row[k] * x[k];
+            }
+            x[i] = v / row[i];
+        }
+    }
+
+    Vector<T> solve(Vector<T>& b) {
+        check_solvable(b.size());
+        T* rhs = new T[size_ + 1];
+        T* x = new T[size_ + 1];
+        for (int i = 0; i < size_; ++i) {
+            rhs[i] = b[i];
+        }
+        solve(rhs, x);
+        Vector<T> out(size_ + 1);
+        for (int i = 0; i < size_; ++i) {
+            out.push_back(x[i]);
+        }
+        delete[] rhs;
+        delete[] x;
+        return out;
+    }
+
+    Matrix<T> solve(Matrix<T>& B) {
+        check_solvable(B.rows());
+        int n = size_;
+        Matrix<T> X(n, B.cols());
+        T* rhs = new T[n + 1];
+        T* x = new T[n + 1];
+        for (int j = 0; j < B.cols(); ++j) {
+            for (int i = 0; i < n; ++i) {
+                rhs[i] = B[i][j];
+            }
+            solve(rhs, x);
+            for (int i = 0; i < n; ++i) {
+                X[i][j] = x[i];
+            }
+        }
+        delete[] rhs;
+        delete[] x;
+        return X;
+    }
+
+    Matrix<T> inverse() {
+        Matrix<T> identity = lu_.identity(size_);
+        return solve(identity);
+    }
+
+    T condition_estimate() {
+        if (singular_) {
+            return T(1) / T(0);
+        }
+        T inv_norm = DecompositionOps<T>::inverse_norm1_estimate(size_,
+            [&](T* b, T* x) { solve(b, x); },
+            [&](T* b, T* x) { solve_transposed_raw(b, x); });
+        return norm1_ * inv_norm;
+    }
+};
+
+template<typename T>
+class CholeskyDecomposition {
+private:
+    Matrix<T> l_;
+    int size_;
+    bool positive_definite_;
+    T norm1_;
+
+    void check_solvable(int length) {
+        if (!positive_definite_) {
+            throw "Matrix is not positive definite, cannot solve";
+        }
+        if (length != size_) {
+            throw "Right-hand side size must match matrix size";
+        }
+    }
+
+public:
+    explicit CholeskyDecomposition(Matrix<T>& A) : l_(), size_(0), positive_definite_(false), norm1_(T(0)) {
+        factor(A);
+    }
+
+    void factor(Matrix<T>& A) {
+        if (!A.is_square()) {
+            throw "Cholesky decomposition requires a square matrix";
+        }
+        int n = A.rows();
+        size_ = n;
+        l_.reshape(n, n);
+        l_.fill(T(0));
+        norm1_ = DecompositionOps<T>::norm1(A);
+        positive_definite_ = true;
+        for (int j = 0; j < n; ++j) {
+            T* row_j = l_[j];
+            T d = A[j][j];
+            for (int k = 0; k < j; ++k) {
+                d = d - row_j[k] * row_j[k];
+            }
+            if (!(d > T(0))) {
+                positive_definite_ = false;
+                return;
+            }
+            T root = sqrt(d);
+            row_j[j] = root;
+            for (int i = j + 1; i < n; ++i) {
+                T* row_i = l_[i];
+                T v = A[i][j];
+                for (int k = 0; k < j; ++k) {
+                    v = v - row_i[k] * row_j[k];
+                }
+                row_i[j] = v / root;
+            }
+        }
+    }
+
+    int size() {
+        return size_;
+    }
+
+    bool is_positive_definite() {
+        return positive_definite_;
+    }
+
+    Matrix<T>& lower() {
+        return l_;
+    }
+
+    T determinant() {
+        if (!positive_definite_) {
+            throw "Matrix is not positive definite";
+        }
+        T det = T(1);
+        for (int i = 0; i < size_; ++i) {
+            det = det * l_[i][i] * l_[i][i];
+        }
+        return det;
+    }
+
+    void solve(T* b, T* x) {
+        check_solvable(size_);
+        int n = size_;
+        for (int i = 0; i < n; ++i) {
+            T* row = l_[i];
+            T v = b[i];
+            for (int k = 0; k < i; ++k) {
+                v = v - row[k] * x[k];
+            }
+            x[i] = v / row[i];
+        }
+        for (int i = n - 1; i >= 0; --i) {
+            T v = x[i];
+            for (int k = i + 1; k < n; ++k) {
+                v = v - l_[k][i] * x[k];
+            }
+            x[i] = v / l_[i][i];
+        }
+    }
+
+    Vector<T> solve(Vector<T>& b) {
+        check_solvable(b.size());
+        T* rhs = new T[size_ + 1];
+        T* x = new T[size_ + 1];
+        for (int i = 0; i < size_; ++i) {
+            rhs[i] = b[i];
+        }
+        solve(rhs, x);
+        Vector<T> out(size_ + 1);
+        for (int i = 0; i < size_; ++i) {
+            out.push_back(x[i]);
+        }
+        delete[] rhs;
+        delete[] x;
+        return out;
+    }
+
+    Matrix<T> solve(Matrix<T>& B) {
+        check_solvable(B.rows());
+        int n = size_;
+        Matrix<T> X(n, B.cols());
+        T* rhs = new T[n + 1];
+        T* x = new T[n + 1];
+        for (int j = 0; j < B.cols(); ++j) {
+            for (int i = 0; i < n; ++i) {
+                rhs[i] = B[i][j];
+            }
+            solve(rhs, x);
+            for (int i = 0; i < n; ++i) {
+                X[i][j] = x[i];
+            }
+        }
+        delete[] rhs;
+        delete[] x;
+        return X;
+    }
+
+    Matrix<T> inverse() {
+        Matrix<T> identity = l_.identity(size_);
+        return solve(identity);
+    }
+
+    T condition_estimate() {
+        if (!positive_definite_) {
+            return T(1) / T(0);
+        }
+        T inv_norm = DecompositionOps<T>::inverse_norm1_estimate(size_,
+            [&](T* b, T* x) { solve(b, x); },
+            [&](T* b, T* x) { solve(b, x); });
+        return norm1_ * inv_norm;
+    }
+};
+
+#endif
@@ -0,0 +1,305 @@
+#ifndef FIXED_MATRIX_H
+#define FIXED_MATRIX_H
+
+#include "Matrix.h"
+#include <cmath>
+
+using namespace std;
+
+template<typename T, int R, int C>
+class FixedMatrix {
+    static_assert(R > 0 && C > 0, "FixedMatrix dimensions must be positive");
+
+private:
+    T data_[R * C];
+
+    static constexpr T abs_value(T v) {
+        return v < T(0) ? -v : v;
+    }
+
+public:
+    typedef T value_type;
+
+    constexpr FixedMatrix() : data_() {}
+
+    constexpr explicit FixedMatrix(const T& value) : data_() {
+        for (int i = 0; i < R * C; ++i) {
+            data_[i] = value;
+        }
+    }
+
+    explicit FixedMatrix(const Matrix<T>& other) : data_() {
+        if (other.rows() != R || other.cols() != C) {
+            throw "Matrix dimensions must match FixedMatrix size";
+        }
+        for (int i = 0; i < R; ++i) {
+            for (int j = 0; j < C; ++j) {
+                data_[i * C + j] = other.at(i, j);
+            }
+        }
+    }
+
+    static constexpr FixedMatrix identity() {
+        static_assert(R == C, "Identity requires a square FixedMatrix");
+        FixedMatrix result;
+        for (int i = 0; i < R; ++i) {
+            result.data_[i * C + i] = T(1);
+        }
+        return result;
+    }
+
+    static constexpr int rows() {
+        return R;
+    }
+
+    static constexpr int cols() {
+        return C;
+    }
+
+    constexpr T* operator[](int row) {
+        return data_ + row * C;
+    }
+
+    constexpr const T* operator[](int row) const {
+        return data_ + row * C;
+    }
+
+    constexpr T at(int row, int col) const {
+        return data_[row * C + col];
+    }
+
+    constexpr T* data() {
+        return data_;
+    }
+
+    Matrix<T> to_matrix() const {
+        Matrix<T> result(R, C);
+        for (int i = 0; i < R; ++i) {
+            for (int j = 0; j < C; ++j) {
+                result[i][j] = data_[i * C + j];
+            }
+        }
+        return result;
+    }
+
+    constexpr FixedMatrix<T, C, R> transpose() const {
+        FixedMatrix<T, C, R> result;
+        for (int i = 0; i < R; ++i) {
+            for (int j = 0; j < C; ++j) {
+                result[j][i] = data_[i * C + j];
+            }
+        }
+        return result;
+    }
+
+    constexpr FixedMatrix operator+(const FixedMatrix& other) const {
+        FixedMatrix result;
+        for (int i = 0; i < R * C; ++i) {
+            result.data_[i] = data_[i] + other.data_[i];
+        }
+        return result;
+    }
+
+    constexpr FixedMatrix operator-(const FixedMatrix& other) const {
+        FixedMatrix result;
+        for (int i = 0; i < R * C; ++i) {
+            result.data_[i] = data_[i] - other.data_[i];
+        }
+        return result;
+    }
+
+    constexpr FixedMatrix scalar_multiply(const T& scalar) const {
+        FixedMatrix result;
+        for (int i = 0; i < R * C; ++i) {
+            result.data_[i] = data_[i] * scalar;
+        }
+        return result;
+    }
+
+    template<int K>
+    constexpr FixedMatrix<T, R, K> operator*(const FixedMatrix<T, C, K>& other) const {
+        FixedMatrix<T, R, K> result;
+        for (int i = 0; i < R; ++i) {
+            for (int p = 0; p < C; ++p) {
+                T a = data_[i * C + p];
+                for (int j = 0; j < K; ++j) {
+                    result[i][j] = result[i][j] + a * other.at(p, j);
+                }
+            }
+        }
+        return result;
+    }
+
+    constexpr bool operator==(const FixedMatrix& other) const {
+        for (int i = 0; i < R * C; ++i) {
+            if (data_[i] != other.data_[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    constexpr bool operator!=(const FixedMatrix& other) const {
+        return !(*this == other);
+    }
+
+    constexpr T trace() const {
+        static_assert(R == C, "Trace requires a square FixedMatrix");
+        T sum = T();
+        for (int i = 0; i < R; ++i) {
+            sum = sum + data_[i * C + i];
+        }
+        return sum;
+    }
+
+    constexpr bool lu_factor(FixedMatrix& lu, int* pivots, int& sign) const {
+        static_assert(R == C, "LU requires a square FixedMatrix");
+        lu = *this;
+        sign = 1;
+        for (int i = 0; i < R; ++i) {
+            pivots[i] = i;
+        }
+        for (int k = 0; k < R; ++k) {
+            int p = k;
+            T best = abs_value(lu.data_[k * C + k]);
+            for (int i = k + 1; i < R; ++i) {
+                T v = abs_value(lu.data_[i * C + k]);
+                if (v > best) {
+                    best = v;
+                    p = i;
+                }
+            }
+            if (best == T(0)) {
+                return false;
+            }
+            if (p != k) {
+                for (int j = 0; j < C; ++j) {
+                    T t = lu.data_[k * C + j];
+                    lu.data_[k * C + j] = lu.data_[p * C + j];
+                    lu.data_[p * C + j] = t;
+                }
+                int t = pivots[k];
+                pivots[k] = pivots[p];
+                pivots[p] = t;
+                sign = -sign;
+            }
+            T pivot = lu.data_[k * C + k];
+            for (int i = k + 1; i < R; ++i) {
+                T factor = lu.data_[i * C + k] / pivot;
+                lu.data_[i * C + k] = factor;
+                for (int j = k + 1; j < C; ++j) {
+                    lu.data_[i * C + j] = lu.data_[i * C + j] - factor * lu.data_[k * C + j];
+                }
+            }
+        }
+        return true;
+    }
+
+    constexpr T determinant() const {
+        static_assert(R == C, "Determinant requires a square FixedMatrix");
+        FixedMatrix lu;
+        int pivots[R] = {};
+        int sign = 1;
+        if (!lu_factor(lu, pivots, sign)) {
+            return T(0);
+        }
+        T det = T(sign);
+        for (int i = 0; i < R; ++i) {
+            det = det * lu.data_[i * C + i];
+        }
+        return det;
+    }
+
+    template<int K>
+    constexpr bool solve(const FixedMatrix<T, R, K>& b, FixedMatrix<T, R, K>& x) const {
+        static_assert(R == C, "Solve requires a square FixedMatrix");
+        FixedMatrix lu;
+        int pivots[R] = {};
+        int sign = 1;
+        if (!lu_factor(lu, pivots, sign)) {
+            return false;
+        }
+        for (int k = 0; k < K; ++k) {
+            for (int i = 0; i < R; ++i) {
+                T v = b.at(pivots[i], k);
+                for (int j = 0; j < i; ++j) {
+                    v = v - lu.data_[i * C + j] * x[j][k];
+                }
+                x[i][k] = v;
+            }
+            for (int i = R - 1; i >= 0; --i) {
+                T v = x[i][k];
+                for (int j = i + 1; j < R; ++j) {
+                    v = v - lu.data_[i * C + j] * x[j][k];
+                }
+                x[i][k] = v / lu.data_[i * C + i];
+            }
+        }
+        return true;
+    }
+
+    template<int K>
+    bool solve_spd(const FixedMatrix<T, R, K>& b, FixedMatrix<T, R, K>& x) const {
+        static_assert(R == C, "Cholesky solve requires a square FixedMatrix");
+        FixedMatrix l;
+        for (int j = 0; j < R; ++j) {
+            T d = data_[j * C + j];
+            for (int k = 0; k < j; ++k) {
+                d = d - l.data_[j * C + k] * l.data_[j * C + k];
+            }
+            if (!(d > T(0))) {
+                return false;
+            }
+            T root = sqrt(d);
+            l.data_[j * C + j] = root;
+            for (int i = j + 1; i < R; ++i) {
+                T v = data_[i * C + j];
+                for (int k = 0; k < j; ++k) {
+                    v = v - l.data_[i * C + k] * l.data_[j * C + k];
+                }
+                l.data_[i * C + j] = v / root;
+            }
+        }
+        for (int k = 0; k < K; ++k) {
+            for (int i = 0; i < R; ++i) {
+                T v = b.at(i, k);
+                for (int j = 0; j < i; ++j) {
+                    v = v - l.data_[i * C + j] * x[j][k];
+                }
+                x[i][k] = v / l.data_[i * C + i];
+            }
+            for (int i = R - 1; i >= 0; --i) {
+                T v = x[i][k];
+                for (int j = i + 1; j < R; ++j) {
+                    v = v - l.data_[j * C + i] * x[j][k];
+                }
+                x[i][k] = v / l.data_[i * C + i];
+            }
+        }
+        return true;
+    }
+
+    constexpr FixedMatrix inverse() const {
+        FixedMatrix result;
+        if (!solve(identity(), result)) {
+            throw "Matrix is singular, cannot compute inverse";
+        }
+        return result;
+    }
+
+    constexpr T norm1() const {
+        T best = T(0);
+        for (int j = 0; j < C; ++j) {
+            T sum = T(0);
+            for (int i = 0; i < R; ++i) {
+                sum = sum + abs_value(data_[i * C + j]);
+            }
+            if (sum > best) {
+                best = sum;
+            }
+        }
+        return best;
+    }
+};
+
+#endif
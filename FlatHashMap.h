@@ -0,0 +1,317 @@
+#ifndef FLAT_HASH_MAP_H
+#define FLAT_HASH_MAP_H
+
+#include "Hash.h"
+#include <new>
+#include <utility>
+
+using namespace std;
+
+template<typename Key, typename Value, typename KeyHash = Hasher<Key>>
+class FlatHashMap {
+private:
+    struct Entry {
+        Key key;
+        Value value;
+        explicit Entry(const Key& k, const Value& v) : key(k), value(v) {}
+        Entry(Entry&& other) : key(std::move(other.key)), value(std::move(other.value)) {}
+    };
+
+    struct Slot {
+        unsigned int hash;
+        int dist;
+    };
+
+    static const int MIN_CAPACITY = 16;
+    static const int MAX_LOAD_NUM = 7;
+    static const int MAX_LOAD_DEN = 8;
+
+    Entry* entries_;
+    Slot* slots_;
+    int capacity_;
+    int mask_;
+    int size_;
+    KeyHash hasher_;
+
+    static unsigned int fingerprint(unsigned long long h) {
+        return (unsigned int)(h >> 32);
+    }
+
+    void allocate(int capacity) {
+        capacity_ = capacity;
+        mask_ = capacity - 1;
+        entries_ = static_cast<Entry*>(::operator new(sizeof(Entry) * (size_t)capacity));
+        slots_ = new Slot[capacity];
+        for (int i = 0; i < capacity; ++i) {
+            slots_[i].dist = -1;
+        }
+    }
+
+    void release() {
+        if (slots_ != nullptr) {
+            for (int i = 0; i < capacity_; ++i) {
+                if (slots_[i].dist >= 0) {
+                    entries_[i].~Entry();
+                }
+            }
+        }
+        ::operator delete(entries_);
+        delete[] slots_;
+        entries_ = nullptr;
+        slots_ = nullptr;
+        capacity_ = 0;
+        mask_ = 0;
+        size_ = 0;
+    }
+
+    static int capacity_for(int count) {
+        int capacity = MIN_CAPACITY;
+        while ((long long)capacity * MAX_LOAD_NUM < (long long)count * MAX_LOAD_DEN) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    void rehash(int new_capacity) {
+        Entry* old_entries = entries_;
+        Slot* old_slots = slots_;
+        int old_capacity = capacity_;
+        allocate(new_capacity);
+        size_ = 0;
+        for (int i = 0; i < old_capacity; ++i) {
+            if (old_slots[i].dist >= 0) {
+                place(std::move(old_entries[i]), old_slots[i].hash);
+                old_entries[i].~Entry();
+            }
+        }
+        ::operator delete(old_entries);
+        delete[] old_slots;
+    }
+
+    void grow_if_full() {
+        if (capacity_ == 0) {
+            allocate(MIN_CAPACITY);
+        } else if ((long long)(size_ + 1) * MAX_LOAD_DEN > (long long)capacity_ * MAX_LOAD_NUM) {
+            rehash(capacity_ * 2);
+        }
+    }
+
+    int place(Entry&& entry, unsigned int hash) {
+        Entry carry(std::move(entry));
+        unsigned int carry_hash = hash;
+        int carry_dist = 0;
+        int index = (int)(hash & (unsigned int)mask_);
+        int placed = -1;
+        while (true) {
+            Slot& slot = slots_[index];
+            if (slot.dist < 0) {
+                new (&entries_[index]) Entry(std::move(carry));
+                slot.hash = carry_hash;
+                slot.dist = carry_dist;
+                size_++;
+                return placed < 0 ? index : placed;
+            }
+            if (slot.dist < carry_dist) {
+                std::swap(entries_[index].key, carry.key);
+                std::swap(entries_[index].value, carry.value);
+                std::swap(slot.hash, carry_hash);
+                std::swap(slot.dist, carry_dist);
+                if (placed < 0) {
+                    placed = index;
+                }
+            }
+            index = (index + 1) & mask_;
+            carry_dist++;
+        }
+    }
+
+    template<typename K>
+    int find_index(const K& key) {
+        if (size_ == 0) {
+            return -1;
+        }
+        unsigned long long h = hasher_(key);
+        unsigned int fp = fingerprint(h);
+        int index = (int)(fp & (unsigned int)mask_);
+        int dist = 0;
+        while (true) {
+            Slot& slot = slots_[index];
+            if (slot.dist < dist) {
+                return -1;
+            }
+            if (slot.hash == fp && entries_[index].key == key) {
+                return index;
+            }
+            index = (index + 1) & mask_;
+            dist++;
+        }
+    }
+
+    void erase_at(int index) {
+        entries_[index].~Entry();
+        int next = (index + 1) & mask_;
+        while (slots_[next].dist > 0) {
+            new (&entries_[index]) Entry(std::move(entries_[next]));
+            entries_[next].~Entry();
+            slots_[index].hash = slots_[next].hash;
+            slots_[index].dist = slots_[next].dist - 1;
+            index = next;
+            next = (next + 1) & mask_;
+        }
+        slots_[index].dist = -1;
+        size_--;
+    }
+
+    void copy_from(const FlatHashMap& other) {
+        if (other.capacity_ == 0) {
+            return;
+        }
+        allocate(other.capacity_);
+        for (int i = 0; i < capacity_; ++i) {
+            slots_[i] = other.slots_[i];
+            if (other.slots_[i].dist >= 0) {
+                new (&entries_[i]) Entry(other.entries_[i].key, other.entries_[i].value);
+            }
+        }
+        size_ = other.size_;
+    }
+
+public:
+    explicit FlatHashMap(int expected = 0) : entries_(nullptr), slots_(nullptr), capacity_(0), mask_(0), size_(0), hasher_() {
+        if (expected > 0) {
+            reserve(expected);
+        }
+    }
+
+    FlatHashMap(const FlatHashMap& other) : entries_(nullptr), slots_(nullptr), capacity_(0), mask_(0), size_(0), hasher_(other.hasher_) {
+        copy_from(other);
+    }
+
+    FlatHashMap(FlatHashMap&& other)
+        : entries_(other.entries_), slots_(other.slots_), capacity_(other.capacity_), mask_(other.mask_), size_(other.size_), hasher_(other.hasher_) {
+        other.entries_ = nullptr;
+        other.slots_ = nullptr;
+        other.capacity_ = 0;
+        other.mask_ = 0;
+        other.size_ = 0;
+    }
+
+    FlatHashMap& operator=(const FlatHashMap& other) {
+        if (this != &other) {
+            release();
+            hasher_ = other.hasher_;
+            copy_from(other);
+        }
+        return *this;
+    }
+
+    FlatHashMap& operator=(FlatHashMap&& other) {
+        if (this != &other) {
+            release();
+            entries_ = other.entries_;
+            slots_ = other.slots_;
+            capacity_ = other.capacity_;
+            mask_ = other.mask_;
+            size_ = other.size_;
+            hasher_ = other.hasher_;
+            other.entries_ = nullptr;
+            other.slots_ = nullptr;
+            other.capacity_ = 0;
+            other.mask_ = 0;
+            other.size_ = 0;
+        }
+        return *this;
+    }
+
+    ~FlatHashMap() {
+        release();
+    }
+
+    void reserve(int count) {
+        int needed = capacity_for(count);
+        if (needed > capacity_) {
+            if (capacity_ == 0) {
+                allocate(needed);
+            } else {
+                rehash(needed);
+            }
+        }
+    }
+
+    void clear() {
+        for (int i = 0; i < capacity_; ++i) {
+            if (slots_[i].dist >= 0) {
+                entries_[i].~Entry();
+                slots_[i].dist = -1;
+            }
+        }
+        size_ = 0;
+    }
+
+    void insert(const Key& key, const Value& value) {
+        int index = find_index(key);
+        if (index >= 0) {
+            entries_[index].value = value;
+            return;
+        }
+        grow_if_full();
+        place(Entry(key, value), fingerprint(hasher_(key)));
+    }
+
+    template<typename K>
+    bool contains(const K& key) {
+        return find_index(key) >= 0;
+    }
+
+    template<typename K>
+    Value* find(const K& key) {
+        int index = find_index(key);
+        if (index < 0) {
+            return nullptr;
+        }
+        return &entries_[index].value;
+    }
+
+    Value& operator[](const Key& key) {
+        int index = find_index(key);
+        if (index >= 0) {
+            return entries_[index].value;
+        }
+        grow_if_full();
+        index = place(Entry(key, Value()), fingerprint(hasher_(key)));
+        return entries_[index].value;
+    }
+
+    template<typename K>
+    bool erase(const K& key) {
+        int index = find_index(key);
+        if (index < 0) {
+            return false;
+        }
+        erase_at(index);
+        return true;
+    }
+
+    template<typename Visitor>
+    void for_each(Visitor visit) {
+        for (int i = 0; i < capacity_; ++i) {
+            if (slots_[i].dist >= 0) {
+                visit(entries_[i].key, entries_[i].value);
+            }
+        }
+    }
+
+    int size() {
+        return size_;
+    }
+
+    int capacity() {
+        return capacity_;
+    }
+
+    bool empty() {
+        return size_ == 0;
+    }
+};
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <type_traits>
+#include <functional>
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+using namespace std;
+
+class Hash {
+private:
+    static const unsigned long long P0 = 0xa0761d6478bd642fULL;
+    static const unsigned long long P1 = 0xe7037ed1a0b428dbULL;
+    static const unsigned long long P2 = 0x8ebc6af09c88c6e3ULL;
+    static const unsigned long long P3 = 0x589965cc75374cc3ULL;
+
+    static void mum(unsigned long long& a, unsigned long long& b) {
+#if defined(__SIZEOF_INT128__)
+        unsigned __int128 r = (unsigned __int128)a * b;
+        a = (unsigned long long)r;
+        b = (unsigned long long)(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+        a = _umul128(a, b, &b);
+#else
+        unsigned long long ha = a >> 32;
+        unsigned long long hb = b >> 32;
+        unsigned long long la = (unsigned int)a;
+        unsigned long long lb = (unsigned int)b;
+        unsigned long long rh = ha * hb;
+        unsigned long long rm0 = ha * lb;
+        unsigned long long rm1 = hb * la;
+        unsigned long long rl = la * lb;
+        unsigned long long t = rl + (rm0 << 32);
+        unsigned long long c = t < rl ? 1 : 0;
+        unsigned long long lo = t + (rm1 << 32);
+        c += lo < t ? 1 : 0;
+        unsigned long long hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+        a = lo;
+        b = hi;
+#endif
+    }
+
+    static unsigned long long mix(unsigned long long a, unsigned long long b) {
+        mum(a, b);
+        return a ^ b;
+    }
+
+    static unsigned long long read8(const unsigned char* p) {
+        unsigned long long v;
+        memcpy(&v, p, 8);
+        return v;
+    }
+
+    static unsigned long long read4(const unsigned char* p) {
+        unsigned int v;
+        memcpy(&v, p, 4);
+        return v;
+    }
+
+    static unsigned long long read3(const unsigned char* p, size_t k) {
+        return ((unsigned long long)p[0] << 16) | ((unsigned long long)p[k >> 1] << 8) | p[k - 1];
+    }
+
+public:
+    static const unsigned long long DEFAULT_SEED = 0x9e3779b97f4a7c15ULL;
+
+    static unsigned long long bytes(const void* key, size_t len, unsigned long long seed = DEFAULT_SEED) {
+        const unsigned char* p = static_cast<const unsigned char*>(key);
+        seed ^= mix(seed ^ P0, P1);
+        unsigned long long a;
+        unsigned long long b;
+        if (len <= 16) {
+            if (len >= 4) {
+                a = (read4(p) << 32) | read4(p + ((len >> 3) << 2));
+                b = (read4(p + len - 4) << 32) | read4(p + len - 4 - ((len >> 3) << 2));
+            } else if (len > 0) {
+                a = read3(p, len);
+                b = 0;
+            } else {
+                a = 0;
+                b = 0;
+            }
+        } else {
+            size_t i = len;
+            if (i > 48) {
+                unsigned long long see1 = seed;
+                unsigned long long see2 = seed;
+                do {
+                    seed = mix(read8(p) ^ P1, read8(p + 8) ^ seed);
+                    see1 = mix(read8(p + 16) ^ P2, read8(p + 24) ^ see1);
+                    see2 = mix(read8(p + 32) ^ P3, read8(p + 40) ^ see2);
+                    p += 48;
+                    i -= 48;
+                } while (i > 48);
+                seed ^= see1 ^ see2;
+            }
+            while (i > 16) {
+                seed = mix(read8(p) ^ P1, read8(p + 8) ^ seed);
+                i -= 16;
+                p += 16;
+            }
+            a = read8(p + i - 16);
+            b = read8(p + i - 8);
+        }
+        a ^= P1;
+        b ^= seed;
+        mum(a, b);
+        return mix(a ^ P0 ^ len, b ^ P1);
+    }
+
+    static unsigned long long integer(unsigned long long x) {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+};
+
+template<typename Key, bool Integral = std::is_integral<Key>::value || std::is_enum<Key>::value || std::is_pointer<Key>::value>
+struct Hasher {
+    unsigned long long operator()(const Key& key) {
+        return Hash::integer((unsigned long long)std::hash<Key>()(key));
+    }
+};
+
+template<typename Key>
+struct Hasher<Key, true> {
+    unsigned long long operator()(const Key& key) {
+        if constexpr (std::is_pointer<Key>::value) {
+            return Hash::integer((unsigned long long)reinterpret_cast<size_t>(key));
+        } else {
+            return Hash::integer((unsigned long long)key);
+        }
+    }
+};
+
+template<>
+struct Hasher<string, false> {
+    unsigned long long operator()(string_view key) {
+        return Hash::bytes(key.data(), key.size());
+    }
+};
+
+template<>
+struct Hasher<string_view, false> {
+    unsigned long long operator()(string_view key) {
+        return Hash::bytes(key.data(), key.size());
+    }
+};
+
+#endif
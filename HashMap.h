@@ -1,6 +1,8 @@
 #ifndef HASH_MAP_H
 #define HASH_MAP_H
 
+#include "Hash.h"
+
 using namespace std;
 
 template<typename Key, typename Value>
@@ -19,20 +21,8 @@ private:
     int size_;
 
     int hash_function(const Key& key) {
-        int hash = 0;
-        const char* key_ptr = reinterpret_cast<const char*>(&key);
-        int key_size = sizeof(Key);
-        for (int i = 0; i < key_size; ++i) {
-            hash = (hash * 31 + static_cast<unsigned char>(key_ptr[i])) % capacity_;
-            if (hash < 0) {
-                hash += capacity_;
-            }
-        }
-        if (hash >= 0) {
-            return hash;
-        } else {
-            return -hash;
-        }
+        Hasher<Key> hasher;
+        return (int)(hasher(key) % (unsigned long long)capacity_);
     }
 
     void rehash() {
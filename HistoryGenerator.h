@@ -0,0 +1,173 @@
+#ifndef HISTORY_GENERATOR_H
+#define HISTORY_GENERATOR_H
+
+#include "Vector.h"
+#include "Stock.h"
+#include "Parallel.h"
+#include <string>
+
+using namespace std;
+
+class HistoryGenerator {
+private:
+    unsigned long long seed_;
+    int base_year_;
+    int horizon_;
+
+    static unsigned long long splitmix64(unsigned long long x) {
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    static unsigned long long hash_name(const string& name) {
+        unsigned long long h = 0xCBF29CE484222325ULL;
+        for (int i = 0; i < (int)name.size(); ++i) {
+            h ^= (unsigned char)name[i];
+            h *= 0x100000001B3ULL;
+        }
+        return h;
+    }
+
+    double uniform(unsigned long long company_key, int year, int draw) {
+        unsigned long long counter = ((unsigned long long)(unsigned int)year << 8) | (unsigned long long)draw;
+        unsigned long long x = splitmix64(company_key ^ splitmix64(counter));
+        return (double)(x >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    unsigned long long company_key(Stock& base) {
+        return splitmix64(seed_ ^ hash_name(base.company_name));
+    }
+
+    bool fill_year(Stock& s, unsigned long long key, int year_offset, Stock& sy) {
+        sy = s;
+        sy.year = s.year + year_offset;
+
+        double base = 1.0 + 0.03 * year_offset;
+        double noise_price = uniform(key, sy.year, 0) * 0.10 - 0.05;
+        double noise_eps = uniform(key, sy.year, 1) * 0.08 - 0.04;
+        double noise_pe = uniform(key, sy.year, 2) * 0.06 - 0.03;
+        double factor_price = base + noise_price;
+        double factor_eps = base + noise_eps;
+        double factor_pe = base + noise_pe;
+
+        sy.price = s.price * factor_price;
+        sy.latest_eps = s.latest_eps * factor_eps;
+        sy.eps_last_quarter = s.eps_last_quarter * factor_eps;
+        sy.last_annual_eps = s.last_annual_eps * factor_eps;
+        sy.pe = s.pe * factor_pe;
+        sy.expected_pe = s.expected_pe * factor_pe;
+        sy.expected_growth = s.expected_growth * factor_eps;
+        sy.peg = s.peg * factor_pe;
+        sy.book_value = s.book_value * factor_price;
+        sy.expected_book_value = s.expected_book_value * factor_price;
+        sy.pb = s.pb * factor_pe;
+        sy.expected_pb = s.expected_pb * factor_pe;
+        sy.roe = s.roe * factor_eps;
+        sy.expected_roe = s.expected_roe * factor_eps;
+        sy.equity_to_asset = s.equity_to_asset;
+        sy.roa = s.roa * factor_eps;
+        sy.last_dividend = s.last_dividend * factor_price;
+        sy.expected_dividend = s.expected_dividend * factor_price;
+        sy.validate();
+        if (!sy.valid) {
+            return false;
+        }
+        sy.compute_derived();
+        return true;
+    }
+
+    void append_company(Stock& s, Vector<Stock>& out_stocks) {
+        out_stocks.push_back(s);
+        unsigned long long key = company_key(s);
+        Stock sy;
+        for (int year_offset = 1; year_offset <= horizon_; ++year_offset) {
+            if (fill_year(s, key, year_offset, sy)) {
+                out_stocks.push_back(sy);
+            }
+        }
+    }
+
+public:
+    static const unsigned long long DEFAULT_SEED = 2022ULL;
+    static const int DEFAULT_HORIZON = 10;
+    static const int MIN_ROWS_PER_THREAD = 4096;
+
+    explicit HistoryGenerator(unsigned long long seed = DEFAULT_SEED, int horizon = DEFAULT_HORIZON)
+        : seed_(seed), base_year_(2022), horizon_(horizon) {
+        if (horizon_ < 0) {
+            horizon_ = 0;
+        }
+    }
+
+    void set_seed(unsigned long long seed) {
+        seed_ = seed;
+    }
+
+    unsigned long long seed() {
+        return seed_;
+    }
+
+    void set_horizon(int horizon) {
+        if (horizon < 0) {
+            horizon = 0;
+        }
+        horizon_ = horizon;
+    }
+
+    int horizon() {
+        return horizon_;
+    }
+
+    int base_year() {
+        return base_year_;
+    }
+
+    bool generate_year(Stock& base, int year, Stock& out) {
+        int year_offset = year - base.year;
+        if (year_offset == 0) {
+            out = base;
+            return base.valid;
+        }
+        if (year_offset < 0 || year_offset > horizon_) {
+            return false;
+        }
+        return fill_year(base, company_key(base), year_offset, out);
+    }
+
+    void generate(Vector<Stock>& snapshot, Vector<Stock>& out_stocks) {
+        out_stocks.reserve(out_stocks.size() + snapshot.size() * (horizon_ + 1));
+        for (int i = 0; i < snapshot.size(); ++i) {
+            append_company(snapshot[i], out_stocks);
+        }
+    }
+
+    void generate_parallel(Vector<Stock>& snapshot, Vector<Stock>& out_stocks, int num_threads = 0) {
+        int n = Parallel::clamp_threads(num_threads, snapshot.size() / MIN_ROWS_PER_THREAD + 1);
+        if (n == 1) {
+            generate(snapshot, out_stocks);
+            return;
+        }
+        Vector<Stock>* parts = new Vector<Stock>[n];
+        Parallel::for_each_range(snapshot.size(), n, [&](int worker, int begin, int end) {
+            parts[worker].reserve((end - begin) * (horizon_ + 1));
+            for (int i = begin; i < end; ++i) {
+                append_company(snapshot[i], parts[worker]);
+            }
+        });
+        int total = out_stocks.size();
+        for (int t = 0; t < n; ++t) {
+            total += parts[t].size();
+        }
+        out_stocks.reserve(total);
+        for (int t = 0; t < n; ++t) {
+            for (int i = 0; i < parts[t].size(); ++i) {
+                out_stocks.push_back(std::move(parts[t][i]));
+            }
+        }
+        delete[] parts;
+    }
+};
+
+#endif
@@ -0,0 +1,279 @@
+#ifndef KD_TREE_H
+#define KD_TREE_H
+
+#include "Vector.h"
+#include "MaxHeap.h"
+
+using namespace std;
+
+struct KdNeighbor {
+    double dist_sq;
+    int id;
+
+    bool operator<(const KdNeighbor& other) {
+        if (dist_sq != other.dist_sq) {
+            return dist_sq < other.dist_sq;
+        }
+        return id < other.id;
+    }
+    bool operator>(const KdNeighbor& other) {
+        if (dist_sq != other.dist_sq) {
+            return dist_sq > other.dist_sq;
+        }
+        return id > other.id;
+    }
+    bool operator<=(const KdNeighbor& other) {
+        return !(*this > other);
+    }
+    bool operator>=(const KdNeighbor& other) {
+        return !(*this < other);
+    }
+    bool operator==(const KdNeighbor& other) {
+        return id == other.id && dist_sq == other.dist_sq;
+    }
+};
+
+template<int D>
+class KdTree {
+private:
+    static const int LEAF_SIZE = 8;
+
+    double* coords_;
+    int* ids_;
+    unsigned char* split_dim_;
+    int size_;
+
+    double* point(int slot) {
+        return coords_ + (long long)slot * D;
+    }
+
+    void swap_slots(int a, int b) {
+        double* pa = point(a);
+        double* pb = point(b);
+        for (int d = 0; d < D; ++d) {
+            double t = pa[d];
+            pa[d] = pb[d];
+            pb[d] = t;
+        }
+        int t = ids_[a];
+        ids_[a] = ids_[b];
+        ids_[b] = t;
+    }
+
+    bool slot_less(int a, int b, int dim) {
+        double va = point(a)[dim];
+        double vb = point(b)[dim];
+        if (va != vb) {
+            return va < vb;
+        }
+        return ids_[a] < ids_[b];
+    }
+
+    void select_nth(int lo, int hi, int nth, int dim) {
+        int l = lo;
+        int r = hi - 1;
+        while (l < r) {
+            int pivot = (l + r) / 2;
+            swap_slots(pivot, r);
+            int store = l;
+            for (int i = l; i < r; ++i) {
+                if (slot_less(i, r, dim)) {
+                    swap_slots(i, store);
+                    store++;
+                }
+            }
+            swap_slots(store, r);
+            if (store == nth) {
+                return;
+            }
+            if (store < nth) {
+                l = store + 1;
+            } else {
+                r = store - 1;
+            }
+        }
+    }
+
+    int widest_dim(int lo, int hi) {
+        int best = 0;
+        double best_spread = -1.0;
+        for (int d = 0; d < D; ++d) {
+            double mn = point(lo)[d];
+            double mx = mn;
+            for (int i = lo + 1; i < hi; ++i) {
+                double v = point(i)[d];
+                if (v < mn) {
+                    mn = v;
+                }
+                if (v > mx) {
+                    mx = v;
+                }
+            }
+            if (mx - mn > best_spread) {
+                best_spread = mx - mn;
+                best = d;
+            }
+        }
+        return best;
+    }
+
+    void build_range(int lo, int hi) {
+        if (hi - lo <= LEAF_SIZE) {
+            return;
+        }
+        int mid = (lo + hi) / 2;
+        int dim = widest_dim(lo, hi);
+        select_nth(lo, hi, mid, dim);
+        split_dim_[mid] = (unsigned char)dim;
+        build_range(lo, mid);
+        build_range(mid + 1, hi);
+    }
+
+    double dist_sq(const double* q, int slot) {
+        double* p = point(slot);
+        double sum = 0.0;
+        for (int d = 0; d < D; ++d) {
+            double diff = q[d] - p[d];
+            sum += diff * diff;
+        }
+        return sum;
+    }
+
+    void offer(MaxHeap<KdNeighbor>& best, int k, double d2, int id) {
+        KdNeighbor n;
+        n.dist_sq = d2;
+        n.id = id;
+        if (best.size() < k) {
+            best.push(n);
+        } else if (n < best.top()) {
+            best.pop();
+            best.push(n);
+        }
+    }
+
+    void search(int lo, int hi, const double* q, int k, int exclude, MaxHeap<KdNeighbor>& best) {
+        if (hi - lo <= LEAF_SIZE) {
+            for (int i = lo; i < hi; ++i) {
+                if (ids_[i] != exclude) {
+                    offer(best, k, dist_sq(q, i), ids_[i]);
+                }
+            }
+            return;
+        }
+        int mid = (lo + hi) / 2;
+        int dim = split_dim_[mid];
+        if (ids_[mid] != exclude) {
+            offer(best, k, dist_sq(q, mid), ids_[mid]);
+        }
+        double diff = q[dim] - point(mid)[dim];
+        if (diff < 0.0) {
+            search(lo, mid, q, k, exclude, best);
+            if (best.size() < k || diff * diff <= best.top().dist_sq) {
+                search(mid + 1, hi, q, k, exclude, best);
+            }
+        } else {
+            search(mid + 1, hi, q, k, exclude, best);
+            if (best.size() < k || diff * diff <= best.top().dist_sq) {
+                search(lo, mid, q, k, exclude, best);
+            }
+        }
+    }
+
+    template<typename Visitor>
+    void search_radius(int lo, int hi, const double* q, double r2, Visitor& visit) {
+        if (hi - lo <= LEAF_SIZE) {
+            for (int i = lo; i < hi; ++i) {
+                double d2 = dist_sq(q, i);
+                if (d2 <= r2) {
+                    visit(ids_[i], d2);
+                }
+            }
+            return;
+        }
+        int mid = (lo + hi) / 2;
+        int dim = split_dim_[mid];
+        double d2 = dist_sq(q, mid);
+        if (d2 <= r2) {
+            visit(ids_[mid], d2);
+        }
+        double diff = q[dim] - point(mid)[dim];
+        if (diff <= 0.0 || diff * diff <= r2) {
+            search_radius(lo, mid, q, r2, visit);
+        }
+        if (diff >= 0.0 || diff * diff <= r2) {
+            search_radius(mid + 1, hi, q, r2, visit);
+        }
+    }
+
+    void release() {
+        delete[] coords_;
+        delete[] ids_;
+        delete[] split_dim_;
+        coords_ = nullptr;
+        ids_ = nullptr;
+        split_dim_ = nullptr;
+        size_ = 0;
+    }
+
+public:
+    explicit KdTree() : coords_(nullptr), ids_(nullptr), split_dim_(nullptr), size_(0) {}
+
+    KdTree(const KdTree& other) = delete;
+    KdTree& operator=(const KdTree& other) = delete;
+
+    ~KdTree() {
+        release();
+    }
+
+    void clear() {
+        release();
+    }
+
+    void build(double** columns, int count) {
+        release();
+        size_ = count;
+        coords_ = new double[(long long)count * D + 1];
+        ids_ = new int[count + 1];
+        split_dim_ = new unsigned char[count + 1];
+        for (int i = 0; i < count; ++i) {
+            double* p = point(i);
+            for (int d = 0; d < D; ++d) {
+                p[d] = columns[d][i];
+            }
+            ids_[i] = i;
+            split_dim_[i] = 0;
+        }
+        build_range(0, count);
+    }
+
+    int size() {
+        return size_;
+    }
+
+    void knn(const double* query, int k, int exclude, Vector<KdNeighbor>& out) {
+        out.clear();
+        if (k <= 0 || size_ == 0) {
+            return;
+        }
+        MaxHeap<KdNeighbor> best;
+        search(0, size_, query, k, exclude, best);
+        int count = best.size();
+        for (int i = 0; i < count; ++i) {
+            out.push_back(best.top());
+        }
+        for (int i = count - 1; i >= 0; --i) {
+            out[i] = best.top();
+            best.pop();
+        }
+    }
+
+    template<typename Visitor>
+    void radius(const double* query, double r, Visitor visit) {
+        if (size_ == 0) {
+            return;
+        }
+        search_radius(0, size_, query, r * r, visit);
+    }
+};
+
+#endif
@@ -2,164 +2,202 @@
 #define LINEAR_REGRESSION_H
 
 #include "Matrix.h"
+#include "Decomposition.h"
+#include "FixedMatrix.h"
 #include "Vector.h"
+#include "Parallel.h"
+#include <cmath>
 
 using namespace std;
 
+enum RegressionSolver {
+    SOLVER_NORMAL_EQUATION,
+    SOLVER_GRADIENT_DESCENT
+};
+
 template<typename T>
 class LinearRegression {
 private:
+    static const int MIN_ROWS_PER_THREAD = 16384;
+    static const int MAX_FIXED_PARAMETERS = 8;
+
     Vector<T> coefficients_;
     T intercept_;
     int num_features_;
     bool is_fitted_;
-
-    Matrix<T> add_intercept_column(Matrix<T>& X) {
-        int rows = X.rows();
-        int cols = X.cols();
-        Matrix<T> X_with_intercept(rows, cols + 1);
-        for (int i = 0; i < rows; ++i) {
-            X_with_intercept[i][0] = T(1);
-            for (int j = 0; j < cols; ++j) {
-                X_with_intercept[i][j + 1] = X[i][j];
+    RegressionSolver solver_;
+    T learning_rate_;
+    int iterations_;
+    int num_threads_;
+    T condition_;
+    T pending_gram_[MAX_FIXED_PARAMETERS * MAX_FIXED_PARAMETERS];
+    int pending_size_;
+
+    void accumulate_gram(Matrix<T>& X, Vector<T>& y, T* gram, T* moments) {
+        int n = X.rows();
+        int m = X.cols();
+        int p = m + 1;
+        int threads = Parallel::clamp_threads(num_threads_, n / MIN_ROWS_PER_THREAD + 1);
+        T* partial_gram = new T[threads * p * p];
+        T* partial_moments = new T[threads * p];
+        Parallel::for_each_range(n, threads, [&](int worker, int begin, int end) {
+            T* g = partial_gram + worker * p * p;
+            T* b = partial_moments + worker * p;
+            T* x = new T[p];
+            for (int i = 0; i < p * p; ++i) {
+                g[i] = T(0);
+            }
+            for (int i = 0; i < p; ++i) {
+                b[i] = T(0);
             }
+            x[0] = T(1);
+            for (int r = begin; r < end; ++r) {
+                T* row = X[r];
+                for (int j = 0; j < m; ++j) {
+                    x[j + 1] = row[j];
+                }
+                T target = y[r];
+                for (int a = 0; a < p; ++a) {
+                    T xa = x[a];
+                    T* ga = g + a * p;
+                    for (int c = a; c < p; ++c) {
+                        ga[c] = ga[c] + xa * x[c];
+                    }
+                    b[a] = b[a] + xa * target;
+                }
+            }
+            delete[] x;
+        });
+        for (int i = 0; i < p * p; ++i) {
+            gram[i] = T(0);
+        }
+        for (int i = 0; i < p; ++i) {
+            moments[i] = T(0);
         }
-        return X_with_intercept;
+        for (int t = 0; t < threads; ++t) {
+            for (int i = 0; i < p * p; ++i) {
+                gram[i] = gram[i] + partial_gram[t * p * p + i];
+            }
+            for (int i = 0; i < p; ++i) {
+                moments[i] = moments[i] + partial_moments[t * p + i];
+            }
+        }
+        for (int a = 0; a < p; ++a) {
+            for (int c = 0; c < a; ++c) {
+                gram[a * p + c] = gram[c * p + a];
+            }
+        }
+        delete[] partial_gram;
+        delete[] partial_moments;
     }
 
     Matrix<T> compute_normal_equation(Matrix<T>& X, Vector<T>& y) {
-        Matrix<T> X_transpose = X.transpose();
-        Matrix<T> XTX = X_transpose * X;
-
-        Matrix<T> XT = X_transpose;
-        Vector<T> XTy(X.cols());
-        for (int i = 0; i < XT.rows(); ++i) {
-            T sum = T();
-            for (int j = 0; j < y.size(); ++j) {
-                sum = sum + (XT[i][j] * y[j]);
+        int p = X.cols() + 1;
+        Matrix<T> gram(p, p);
+        Vector<T> moments(p + 1);
+        for (int i = 0; i < p; ++i) {
+            moments.push_back(T(0));
+        }
+        accumulate_gram(X, y, gram.data(), &moments[0]);
+        CholeskyDecomposition<T> cholesky(gram);
+        if (!cholesky.is_positive_definite()) {
+            T lambda = T(0.01);
+            for (int i = 1; i < p; ++i) {
+                gram[i][i] = gram[i][i] + lambda;
             }
-            XTy[i] = sum;
-        }
-
-        Matrix<T> XTX_inv = compute_pseudo_inverse(XTX);
-
-        Vector<T> theta(XTX_inv.rows());
-        for (int i = 0; i < XTX_inv.rows(); ++i) {
-            T sum = T();
-            for (int j = 0; j < XTy.size(); ++j) {
-                sum = sum + (XTX_inv[i][j] * XTy[j]);
+            cholesky.factor(gram);
+            if (!cholesky.is_positive_definite()) {
+                throw "Normal equation is singular, cannot fit";
             }
-            theta[i] = sum;
         }
-
+        condition_ = cholesky.condition_estimate();
+        Vector<T> theta = cholesky.solve(moments);
         return create_matrix_from_vector(theta);
     }
 
-    Matrix<T> compute_pseudo_inverse(Matrix<T>& A) {
-        Matrix<T> A_transpose = A.transpose();
-        Matrix<T> ATA = A_transpose * A;
-
-        T det = ATA.determinant();
-        if (det == T(0)) {
-            return compute_regularized_inverse(ATA);
+    template<int P>
+    bool solve_fixed(T* gram, T* moments, T* theta) {
+        FixedMatrix<T, P, P> A;
+        FixedMatrix<T, P, 1> b;
+        FixedMatrix<T, P, 1> x;
+        for (int i = 0; i < P; ++i) {
+            for (int j = 0; j < P; ++j) {
+                A[i][j] = gram[i * P + j];
+            }
+            b[i][0] = moments[i];
         }
-
-        return compute_inverse_2x2_or_general(ATA);
-    }
-
-    Matrix<T> compute_regularized_inverse(Matrix<T>& A) {
-        T lambda = T(0.01);
-        Matrix<T> identity = A.identity(A.rows());
-        Matrix<T> scaled_identity = identity.scalar_multiply(lambda);
-        Matrix<T> regularized = A + scaled_identity;
-        return compute_inverse_2x2_or_general(regularized);
+        if (!A.solve_spd(b, x)) {
+            T lambda = T(0.01);
+            for (int i = 1; i < P; ++i) {
+                A[i][i] = A[i][i] + lambda;
+            }
+            if (!A.solve_spd(b, x)) {
+                return false;
+            }
+        }
+        for (int i = 0; i < P * P; ++i) {
+            pending_gram_[i] = A.data()[i];
+        }
+        pending_size_ = P;
+        for (int i = 0; i < P; ++i) {
+            theta[i] = x[i][0];
+        }
+        return true;
     }
 
-    Matrix<T> compute_inverse_2x2_or_general(Matrix<T>& A) {
-        if (A.rows() == 2 && A.cols() == 2) {
-            return inverse_2x2(A);
-        } else {
-            return gauss_jordan_inverse(A);
+    void copy_pending_condition(LinearRegression& other) {
+        pending_size_ = other.pending_size_;
+        for (int i = 0; i < pending_size_ * pending_size_; ++i) {
+            pending_gram_[i] = other.pending_gram_[i];
         }
     }
 
-    Matrix<T> inverse_2x2(Matrix<T>& A) {
-        T det = A.determinant();
-        if (det == T(0)) {
-            throw "Matrix is singular, cannot compute inverse";
+    bool solve_small_normal_equation(int p, T* gram, T* moments, T* theta) {
+        switch (p) {
+            case 1: return solve_fixed<1>(gram, moments, theta);
+            case 2: return solve_fixed<2>(gram, moments, theta);
+            case 3: return solve_fixed<3>(gram, moments, theta);
+            case 4: return solve_fixed<4>(gram, moments, theta);
+            case 5: return solve_fixed<5>(gram, moments, theta);
+            case 6: return solve_fixed<6>(gram, moments, theta);
+            case 7: return solve_fixed<7>(gram, moments, theta);
+            case 8: return solve_fixed<8>(gram, moments, theta);
         }
-        Matrix<T> result(2, 2);
-        result[0][0] = A[1][1] / det;
-        result[0][1] = -A[0][1] / det;
-        result[1][0] = -A[1][0] / det;
-        result[1][1] = A[0][0] / det;
-        return result;
+        throw "Too many parameters for a fixed-size solve";
     }
 
-    Matrix<T> gauss_jordan_inverse(Matrix<T>& A) {
-        int n = A.rows();
-        Matrix<T> augmented(n, 2 * n);
-        Matrix<T> identity = A.identity(n);
-
-        for (int i = 0; i < n; ++i) {
-            for (int j = 0; j < n; ++j) {
-                augmented[i][j] = A[i][j];
-                augmented[i][j + n] = identity[i][j];
-            }
+    void fit_gradient_descent(Matrix<T>& X, Vector<T>& y) {
+        int n = X.rows();
+        int m = X.cols();
+        Vector<T> grad_w(m + 1);
+        for (int j = 0; j < m; ++j) {
+            grad_w.push_back(T(0));
         }
-
-        for (int i = 0; i < n; ++i) {
-            int max_row = i;
-            T max_val = augmented[i][i];
-            if (max_val < T(0)) {
-                max_val = -max_val;
-            }
-
-            for (int k = i + 1; k < n; ++k) {
-                T val = augmented[k][i];
-                if (val < T(0)) {
-                    val = -val;
-                }
-                if (val > max_val) {
-                    max_val = val;
-                    max_row = k;
-                }
+        for (int iter = 0; iter < iterations_; ++iter) {
+            T grad_b = T(0);
+            for (int j = 0; j < m; ++j) {
+                grad_w[j] = T(0);
             }
 
-            if (max_row != i) {
-                for (int j = 0; j < 2 * n; ++j) {
-                    T temp = augmented[i][j];
-                    augmented[i][j] = augmented[max_row][j];
-                    augmented[max_row][j] = temp;
+            for (int i = 0; i < n; ++i) {
+                T* row = X[i];
+                T pred = intercept_;
+                for (int j = 0; j < m; ++j) {
+                    pred = pred + (coefficients_[j] * row[j]);
                 }
-            }
-
-            T pivot = augmented[i][i];
-            if (pivot == T(0)) {
-                throw "Matrix is singular, cannot compute inverse";
-            }
-
-            for (int j = 0; j < 2 * n; ++j) {
-                augmented[i][j] = augmented[i][j] / pivot;
-            }
-
-            for (int k = 0; k < n; ++k) {
-                if (k != i) {
-                    T factor = augmented[k][i];
-                    for (int j = 0; j < 2 * n; ++j) {
-                        augmented[k][j] = augmented[k][j] - (factor * augmented[i][j]);
-                    }
+                T error = pred - y[i];
+                grad_b = grad_b + error;
+                for (int j = 0; j < m; ++j) {
+                    grad_w[j] = grad_w[j] + (error * row[j]);
                 }
             }
-        }
 
-        Matrix<T> result(n, n);
-        for (int i = 0; i < n; ++i) {
-            for (int j = 0; j < n; ++j) {
-                result[i][j] = augmented[i][j + n];
+            T scale = learning_rate_ / T(n);
+            intercept_ = intercept_ - (scale * grad_b);
+            for (int j = 0; j < m; ++j) {
+                coefficients_[j] = coefficients_[j] - (scale * grad_w[j]);
             }
         }
-        return result;
     }
 
     Matrix<T> create_matrix_from_vector(Vector<T>& v) {
@@ -195,24 +233,42 @@ private:
     }
 
 public:
-    explicit LinearRegression() {
+    explicit LinearRegression(RegressionSolver solver = SOLVER_NORMAL_EQUATION) {
         intercept_ = T(0);
         num_features_ = 0;
         is_fitted_ = false;
+        solver_ = solver;
+        learning_rate_ = T(0.05);
+        iterations_ = 200;
+        num_threads_ = 0;
+        condition_ = T(0);
+        pending_size_ = 0;
     }
 
     LinearRegression(LinearRegression& other)
         : coefficients_(other.coefficients_),
           intercept_(other.intercept_),
           num_features_(other.num_features_),
-          is_fitted_(other.is_fitted_) {
+          is_fitted_(other.is_fitted_),
+          solver_(other.solver_),
+          learning_rate_(other.learning_rate_),
+          iterations_(other.iterations_),
+          num_threads_(other.num_threads_),
+          condition_(other.condition_) {
+        copy_pending_condition(other);
     }
 
     LinearRegression(LinearRegression&& other)
         : coefficients_(other.coefficients_),
           intercept_(other.intercept_),
           num_features_(other.num_features_),
-          is_fitted_(other.is_fitted_) {
+          is_fitted_(other.is_fitted_),
+          solver_(other.solver_),
+          learning_rate_(other.learning_rate_),
+          iterations_(other.iterations_),
+          num_threads_(other.num_threads_),
+          condition_(other.condition_) {
+        copy_pending_condition(other);
         other.coefficients_ = Vector<T>();
         other.intercept_ = T(0);
         other.num_features_ = 0;
@@ -225,6 +281,12 @@ public:
             intercept_ = other.intercept_;
             num_features_ = other.num_features_;
             is_fitted_ = other.is_fitted_;
+            solver_ = other.solver_;
+            learning_rate_ = other.learning_rate_;
+            iterations_ = other.iterations_;
+            num_threads_ = other.num_threads_;
+            condition_ = other.condition_;
+            copy_pending_condition(other);
         }
         return *this;
     }
@@ -235,6 +297,12 @@ public:
             intercept_ = other.intercept_;
             num_features_ = other.num_features_;
             is_fitted_ = other.is_fitted_;
+            solver_ = other.solver_;
+            learning_rate_ = other.learning_rate_;
+            iterations_ = other.iterations_;
+            num_threads_ = other.num_threads_;
+            condition_ = other.condition_;
+            copy_pending_condition(other);
             other.coefficients_ = Vector<T>();
             other.intercept_ = T(0);
             other.num_features_ = 0;
@@ -246,6 +314,43 @@ public:
     ~LinearRegression() {
     }
 
+    void set_solver(RegressionSolver solver) {
+        solver_ = solver;
+    }
+
+    RegressionSolver get_solver() {
+        return solver_;
+    }
+
+    void set_gradient_descent(T learning_rate, int iterations) {
+        if (iterations <= 0) {
+            throw "Gradient descent needs a positive iteration count";
+        }
+        learning_rate_ = learning_rate;
+        iterations_ = iterations;
+    }
+
+    void set_num_threads(int num_threads) {
+        num_threads_ = num_threads;
+    }
+
+    T get_condition_number() {
+        if (!is_fitted_) {
+            throw "Model must be fitted before getting condition number";
+        }
+        if (pending_size_ > 0) {
+            int p = pending_size_;
+            Matrix<T> gram(p, p);
+            for (int i = 0; i < p * p; ++i) {
+                gram.data()[i] = pending_gram_[i];
+            }
+            CholeskyDecomposition<T> cholesky(gram);
+            condition_ = cholesky.condition_estimate();
+            pending_size_ = 0;
+        }
+        return condition_;
+    }
+
     void fit(Matrix<T>& X, Vector<T>& y) {
         int n = X.rows();
         if (n != y.size()) {
@@ -263,33 +368,28 @@ public:
             coefficients_.push_back(T(0));
         }
         intercept_ = T(0);
-
-        T learning_rate = T(0.05);
-        int iterations = 200;
-
-        for (int iter = 0; iter < iterations; ++iter) {
-            T grad_b = T(0);
-            Vector<T> grad_w;
-            for (int j = 0; j < m; ++j) {
-                grad_w.push_back(T(0));
+        condition_ = T(0);
+        pending_size_ = 0;
+
+        if (solver_ == SOLVER_GRADIENT_DESCENT) {
+            fit_gradient_descent(X, y);
+        } else if (m + 1 <= MAX_FIXED_PARAMETERS) {
+            T gram[MAX_FIXED_PARAMETERS * MAX_FIXED_PARAMETERS];
+            T moments[MAX_FIXED_PARAMETERS];
+            T theta[MAX_FIXED_PARAMETERS];
+            accumulate_gram(X, y, gram, moments);
+            if (!solve_small_normal_equation(m + 1, gram, moments, theta)) {
+                throw "Normal equation is singular, cannot fit";
             }
-
-            for (int i = 0; i < n; ++i) {
-                T pred = intercept_;
-                for (int j = 0; j < m; ++j) {
-                    pred = pred + (coefficients_[j] * X[i][j]);
-                }
-                T error = pred - y[i];
-                grad_b = grad_b + error;
-                for (int j = 0; j < m; ++j) {
-                    grad_w[j] = grad_w[j] + (error * X[i][j]);
-                }
+            intercept_ = theta[0];
+            for (int j = 0; j < m; ++j) {
+                coefficients_[j] = theta[j + 1];
             }
-
-            T scale = learning_rate / T(n);
-            intercept_ = intercept_ - (scale * grad_b);
+        } else {
+            Matrix<T> theta = compute_normal_equation(X, y);
+            intercept_ = theta[0][0];
             for (int j = 0; j < m; ++j) {
-                coefficients_[j] = coefficients_[j] - (scale * grad_w[j]);
+                coefficients_[j] = theta[j + 1][0];
             }
         }
 
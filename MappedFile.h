@@ -0,0 +1,133 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+class MappedFile {
+private:
+    const char* data_;
+    long long size_;
+#ifdef _WIN32
+    HANDLE file_;
+    HANDLE mapping_;
+#else
+    int fd_;
+#endif
+
+public:
+    explicit MappedFile() : data_(nullptr), size_(0) {
+#ifdef _WIN32
+        file_ = INVALID_HANDLE_VALUE;
+        mapping_ = NULL;
+#else
+        fd_ = -1;
+#endif
+    }
+
+    MappedFile(const MappedFile& other) = delete;
+    MappedFile& operator=(const MappedFile& other) = delete;
+
+    ~MappedFile() {
+        close();
+    }
+
+    bool open(const string& path) {
+        close();
+#ifdef _WIN32
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file_ == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file_, &file_size) || file_size.QuadPart == 0) {
+            close();
+            return false;
+        }
+        mapping_ = CreateFileMappingA(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping_ == NULL) {
+            close();
+            return false;
+        }
+        void* view = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+        if (view == NULL) {
+            close();
+            return false;
+        }
+        data_ = static_cast<const char*>(view);
+        size_ = (long long)file_size.QuadPart;
+#else
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd_, &st) != 0 || st.st_size == 0) {
+            close();
+            return false;
+        }
+        void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (view == MAP_FAILED) {
+            close();
+            return false;
+        }
+        madvise(view, (size_t)st.st_size, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(view);
+        size_ = (long long)st.st_size;
+#endif
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (data_ != nullptr) {
+            UnmapViewOfFile(data_);
+        }
+        if (mapping_ != NULL) {
+            CloseHandle(mapping_);
+            mapping_ = NULL;
+        }
+        if (file_ != INVALID_HANDLE_VALUE) {
+            CloseHandle(file_);
+            file_ = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (data_ != nullptr) {
+            munmap(const_cast<char*>(data_), (size_t)size_);
+        }
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    const char* data() {
+        return data_;
+    }
+
+    long long size() {
+        return size_;
+    }
+
+    bool is_open() {
+        return data_ != nullptr;
+    }
+};
+
+#endif
@@ -2,76 +2,315 @@
 #define MATRIX_H
 
 #include "Vector.h"
+#include "CpuFeatures.h"
+#include "Parallel.h"
+#include "MatrixExpr.h"
+#include <new>
+#include <type_traits>
 
 using namespace std;
 
 template<typename T>
-class Matrix {
+class LuDecomposition;
+
+template<typename T>
+class Matrix : public MatrixExpr<Matrix<T>> {
 private:
-    Vector<Vector<T>> data;
+    static const int ALIGNMENT = 64;
+    static const int TRANSPOSE_TILE = 32;
+    static const int GEMM_MR = 4;
+    static const int GEMM_NR = 8;
+    static const int GEMM_MC = 128;
+    static const int GEMM_KC = 256;
+    static const int GEMM_NC = 1024;
+    static const long long GEMM_MIN_FLOPS = 32768;
+
+    T* data_;
     int rows_;
     int cols_;
 
-    void initialize_matrix(int rows, int cols, const T& value = T()) {
-        rows_ = rows;
-        cols_ = cols;
-        data.clear();
-        for (int i = 0; i < rows_; ++i) {
-            Vector<T> row;
-            for (int j = 0; j < cols_; ++j) {
-                row.push_back(value);
-            }
-            data.push_back(row);
+    static T* allocate(long long count) {
+        if (count <= 0) {
+            return nullptr;
+        }
+        return static_cast<T*>(::operator new(sizeof(T) * (size_t)count, std::align_val_t(ALIGNMENT)));
+    }
+
+    static void release(T* block) {
+        if (block != nullptr) {
+            ::operator delete(block, std::align_val_t(ALIGNMENT));
         }
     }
 
-    void copy_matrix(Matrix& other) {
+    long long count() const {
+        return (long long)rows_ * cols_;
+    }
+
+    void swap_storage(Matrix& other) {
+        T* data = data_;
+        int rows = rows_;
+        int cols = cols_;
+        data_ = other.data_;
         rows_ = other.rows_;
         cols_ = other.cols_;
-        data.clear();
-        for (int i = 0; i < rows_; ++i) {
-            Vector<T> row;
-            for (int j = 0; j < cols_; ++j) {
-                row.push_back(other.data[i][j]);
+        other.data_ = data;
+        other.rows_ = rows;
+        other.cols_ = cols;
+    }
+
+    void initialize_matrix(int rows, int cols, const T& value = T()) {
+        reshape(rows, cols);
+        long long n = count();
+        for (long long i = 0; i < n; ++i) {
+            data_[i] = value;
+        }
+    }
+
+    void copy_matrix(const Matrix& other) {
+        reshape(other.rows_, other.cols_);
+        long long n = count();
+        for (long long i = 0; i < n; ++i) {
+            data_[i] = other.data_[i];
+        }
+    }
+
+    static void pack_a(T* A, int lda, int m, int ic, int pc, int mc, int kc, T* packed) {
+        for (int ir = 0; ir < mc; ir += GEMM_MR) {
+            T* panel = packed + (long long)ir * kc;
+            for (int p = 0; p < kc; ++p) {
+                for (int i = 0; i < GEMM_MR; ++i) {
+                    int row = ic + ir + i;
+                    panel[p * GEMM_MR + i] = (ir + i < mc && row < m) ? A[(long long)row * lda + pc + p] : T();
+                }
+            }
+        }
+    }
+
+    static void pack_b(T* B, int ldb, int pc, int jc, int kc, int nc, T* packed) {
+        for (int jr = 0; jr < nc; jr += GEMM_NR) {
+            T* panel = packed + (long long)jr * kc;
+            for (int p = 0; p < kc; ++p) {
+                T* src = B + (long long)(pc + p) * ldb + jc + jr;
+                int width = nc - jr < GEMM_NR ? nc - jr : GEMM_NR;
+                for (int j = 0; j < width; ++j) {
+                    panel[p * GEMM_NR + j] = src[j];
+                }
+                for (int j = width; j < GEMM_NR; ++j) {
+                    panel[p * GEMM_NR + j] = T();
+                }
+            }
+        }
+    }
+
+    static void micro_kernel(int kc, T* a, T* b, T* c, int ldc, int mr, int nr) {
+        T acc[GEMM_MR * GEMM_NR];
+        for (int i = 0; i < GEMM_MR * GEMM_NR; ++i) {
+            acc[i] = T();
+        }
+        for (int p = 0; p < kc; ++p) {
+            T* bp = b + p * GEMM_NR;
+            for (int i = 0; i < GEMM_MR; ++i) {
+                T ai = a[p * GEMM_MR + i];
+                for (int j = 0; j < GEMM_NR; ++j) {
+                    acc[i * GEMM_NR + j] = acc[i * GEMM_NR + j] + ai * bp[j];
+                }
+            }
+        }
+        for (int i = 0; i < mr; ++i) {
+            for (int j = 0; j < nr; ++j) {
+                c[(long long)i * ldc + j] = c[(long long)i * ldc + j] + acc[i * GEMM_NR + j];
+            }
+        }
+    }
+
+#ifdef CPU_FEATURES_X86
+    TARGET_AVX2_FMA static void micro_kernel_avx2(int kc, double* a, double* b, double* c, int ldc, int mr, int nr) {
+        __m256d c00 = _mm256_setzero_pd();
+        __m256d c01 = _mm256_setzero_pd();
+        __m256d c10 = _mm256_setzero_pd();
+        __m256d c11 = _mm256_setzero_pd();
+        __m256d c20 = _mm256_setzero_pd();
+        __m256d c21 = _mm256_setzero_pd();
+        __m256d c30 = _mm256_setzero_pd();
+        __m256d c31 = _mm256_setzero_pd();
+        for (int p = 0; p < kc; ++p) {
+            __m256d b0 = _mm256_load_pd(b + p * 8);
+            __m256d b1 = _mm256_load_pd(b + p * 8 + 4);
+            __m256d a0 = _mm256_broadcast_sd(a + p * 4);
+            __m256d a1 = _mm256_broadcast_sd(a + p * 4 + 1);
+            __m256d a2 = _mm256_broadcast_sd(a + p * 4 + 2);
+            __m256d a3 = _mm256_broadcast_sd(a + p * 4 + 3);
+            c00 = _mm256_fmadd_pd(a0, b0, c00);
+            c01 = _mm256_fmadd_pd(a0, b1, c01);
+            c10 = _mm256_fmadd_pd(a1, b0, c10);
+            c11 = _mm256_fmadd_pd(a1, b1, c11);
+            c20 = _mm256_fmadd_pd(a2, b0, c20);
+            c21 = _mm256_fmadd_pd(a2, b1, c21);
+            c30 = _mm256_fmadd_pd(a3, b0, c30);
+            c31 = _mm256_fmadd_pd(a3, b1, c31);
+        }
+        if (mr == 4 && nr == 8) {
+            double* r0 = c;
+            double* r1 = c + ldc;
+            double* r2 = c + 2LL * ldc;
+            double* r3 = c + 3LL * ldc;
+            _mm256_storeu_pd(r0, _mm256_add_pd(_mm256_loadu_pd(r0), c00));
+            _mm256_storeu_pd(r0 + 4, _mm256_add_pd(_mm256_loadu_pd(r0 + 4), c01));
+            _mm256_storeu_pd(r1, _mm256_add_pd(_mm256_loadu_pd(r1), c10));
+            _mm256_storeu_pd(r1 + 4, _mm256_add_pd(_mm256_loadu_pd(r1 + 4), c11));
+            _mm256_storeu_pd(r2, _mm256_add_pd(_mm256_loadu_pd(r2), c20));
+            _mm256_storeu_pd(r2 + 4, _mm256_add_pd(_mm256_loadu_pd(r2 + 4), c21));
+            _mm256_storeu_pd(r3, _mm256_add_pd(_mm256_loadu_pd(r3), c30));
+            _mm256_storeu_pd(r3 + 4, _mm256_add_pd(_mm256_loadu_pd(r3 + 4), c31));
+            return;
+        }
+        alignas(32) double acc[GEMM_MR * GEMM_NR];
+        _mm256_store_pd(acc, c00);
+        _mm256_store_pd(acc + 4, c01);
+        _mm256_store_pd(acc + 8, c10);
+        _mm256_store_pd(acc + 12, c11);
+        _mm256_store_pd(acc + 16, c20);
+        _mm256_store_pd(acc + 20, c21);
+        _mm256_store_pd(acc + 24, c30);
+        _mm256_store_pd(acc + 28, c31);
+        for (int i = 0; i < mr; ++i) {
+            for (int j = 0; j < nr; ++j) {
+                c[(long long)i * ldc + j] += acc[i * GEMM_NR + j];
+            }
+        }
+    }
+#endif
+
+    static bool use_avx2_kernel() {
+#ifdef CPU_FEATURES_X86
+        if (std::is_same<T, double>::value) {
+            static bool supported = CpuFeatures::has_avx2() && CpuFeatures::has_fma();
+            return supported;
+        }
+#endif
+        return false;
+    }
+
+    static void run_micro_kernel(bool simd, int kc, T* a, T* b, T* c, int ldc, int mr, int nr) {
+#ifdef CPU_FEATURES_X86
+        if constexpr (std::is_same<T, double>::value) {
+            if (simd) {
+                micro_kernel_avx2(kc, a, b, c, ldc, mr, nr);
+                return;
             }
-            data.push_back(row);
         }
+#endif
+        micro_kernel(kc, a, b, c, ldc, mr, nr);
+    }
+
+    int row_range_threads() const {
+        return MatrixParallel::threads(rows_, count(), MatrixParallel::MIN_ELEMENTS);
+    }
+
+    template<typename Fn>
+    void for_each_row_range(Fn fn) const {
+        long long cols = cols_;
+        Parallel::for_each_range(rows_, row_range_threads(), [&](int worker, int begin, int end) {
+            fn(worker, begin * cols, end * cols);
+        });
+    }
+
+    static void multiply_naive(T* A, T* B, T* C, int m, int k, int n) {
+        for (int i = 0; i < m; ++i) {
+            T* c = C + (long long)i * n;
+            for (int p = 0; p < k; ++p) {
+                T a = A[(long long)i * k + p];
+                T* b = B + (long long)p * n;
+                for (int j = 0; j < n; ++j) {
+                    c[j] = c[j] + a * b[j];
+                }
+            }
+        }
+    }
+
+    static void multiply_blocked(T* A, T* B, T* C, int m, int k, int n) {
+        bool simd = use_avx2_kernel();
+        int panels = (m + GEMM_MR - 1) / GEMM_MR;
+        int threads = MatrixParallel::threads(panels, (long long)m * k * n, MatrixParallel::MIN_FLOPS);
+        long long a_size = (long long)(GEMM_MC + GEMM_MR) * GEMM_KC;
+        T* packed_a = allocate(a_size * threads);
+        T* packed_b = allocate((long long)(GEMM_NC + GEMM_NR) * GEMM_KC);
+        for (int jc = 0; jc < n; jc += GEMM_NC) {
+            int nc = n - jc < GEMM_NC ? n - jc : GEMM_NC;
+            for (int pc = 0; pc < k; pc += GEMM_KC) {
+                int kc = k - pc < GEMM_KC ? k - pc : GEMM_KC;
+                pack_b(B, n, pc, jc, kc, nc, packed_b);
+                Parallel::for_each_range(panels, threads, [&](int worker, int first, int last) {
+                    T* own_a = packed_a + a_size * worker;
+                    int end = last * GEMM_MR < m ? last * GEMM_MR : m;
+                    for (int ic = first * GEMM_MR; ic < end; ic += GEMM_MC) {
+                        int mc = end - ic < GEMM_MC ? end - ic : GEMM_MC;
+                        pack_a(A, k, m, ic, pc, mc, kc, own_a);
+                        for (int jr = 0; jr < nc; jr += GEMM_NR) {
+                            int nr = nc - jr < GEMM_NR ? nc - jr : GEMM_NR;
+                            for (int ir = 0; ir < mc; ir += GEMM_MR) {
+                                int mr = mc - ir < GEMM_MR ? mc - ir : GEMM_MR;
+                                T* c = C + (long long)(ic + ir) * n + jc + jr;
+                                run_micro_kernel(simd, kc, own_a + (long long)ir * kc, packed_b + (long long)jr * kc, c, n, mr, nr);
+                            }
+                        }
+                    }
+                });
+            }
+        }
+        release(packed_a);
+        release(packed_b);
     }
 
 public:
-    explicit Matrix(int rows = 0, int cols = 0, const T& value = T()) {
+    typedef T value_type;
+
+    explicit Matrix(int rows = 0, int cols = 0, const T& value = T()) : data_(nullptr), rows_(0), cols_(0) {
         if (rows > 0 && cols > 0) {
             initialize_matrix(rows, cols, value);
-        } else {
-            rows_ = 0;
-            cols_ = 0;
         }
     }
 
-    Matrix(Matrix& other) {
+    Matrix(const Matrix& other) : data_(nullptr), rows_(0), cols_(0) {
         copy_matrix(other);
     }
 
-    Matrix(Matrix&& other)
-        : data(other.data), rows_(other.rows_), cols_(other.cols_) {
-        other.data = Vector<Vector<T>>();
+    template<typename E>
+    Matrix(const MatrixExpr<E>& expr) : data_(nullptr), rows_(0), cols_(0) {
+        expr.derived().evaluate_into(*this);
+    }
+
+    Matrix(Matrix&& other) : data_(other.data_), rows_(other.rows_), cols_(other.cols_) {
+        other.data_ = nullptr;
         other.rows_ = 0;
         other.cols_ = 0;
     }
 
-    Matrix& operator=(Matrix& other) {
+    Matrix& operator=(const Matrix& other) {
         if (this != &other) {
             copy_matrix(other);
         }
         return *this;
     }
 
+    template<typename E>
+    Matrix& operator=(const MatrixExpr<E>& expr) {
+        if (expr.derived().references(this)) {
+            Matrix evaluated(expr);
+            swap_storage(evaluated);
+        } else {
+            expr.derived().evaluate_into(*this);
+        }
+        return *this;
+    }
+
     Matrix& operator=(Matrix&& other) {
         if (this != &other) {
-            data = other.data;
+            release(data_);
+            data_ = other.data_;
             rows_ = other.rows_;
             cols_ = other.cols_;
-            other.data = Vector<Vector<T>>();
+            other.data_ = nullptr;
             other.rows_ = 0;
             other.cols_ = 0;
         }
@@ -79,36 +318,76 @@ public:
     }
 
     ~Matrix() {
-        data.clear();
+        release(data_);
+    }
+
+    void reshape(int rows, int cols) {
+        if (rows <= 0 || cols <= 0) {
+            release(data_);
+            data_ = nullptr;
+            rows_ = 0;
+            cols_ = 0;
+            return;
+        }
+        if ((long long)rows * cols != count()) {
+            release(data_);
+            data_ = allocate((long long)rows * cols);
+        }
+        rows_ = rows;
+        cols_ = cols;
     }
 
     void set_element(int row, int col, const T& value) {
         if (row < 0 || row >= rows_ || col < 0 || col >= cols_) {
             throw "Matrix index out of range";
         }
-        data[row][col] = value;
+        data_[(long long)row * cols_ + col] = value;
     }
 
     T& get_element(int row, int col) {
         if (row < 0 || row >= rows_ || col < 0 || col >= cols_) {
             throw "Matrix index out of range";
         }
-        return data[row][col];
+        return data_[(long long)row * cols_ + col];
     }
 
-
-    Vector<T>& operator[](int row) {
+    T* operator[](int row) {
         if (row < 0 || row >= rows_) {
             throw "Matrix row index out of range";
         }
-        return data[row];
+        return data_ + (long long)row * cols_;
+    }
+
+    T* data() {
+        return data_;
+    }
+
+    const T* data() const {
+        return data_;
+    }
+
+    T at(int row, int col) const {
+        return data_[(long long)row * cols_ + col];
     }
 
-    int rows() {
+    bool references(const void* matrix) const {
+        return matrix == this;
+    }
+
+    void prepare() const {
+    }
+
+    void evaluate_into(Matrix& out) const {
+        if (&out != this) {
+            out.copy_matrix(*this);
+        }
+    }
+
+    int rows() const {
         return rows_;
     }
 
-    int cols() {
+    int cols() const {
         return cols_;
     }
 
@@ -116,91 +395,119 @@ public:
         return (rows_ == cols_);
     }
 
-    Matrix transpose() {
-        Matrix result(cols_, rows_);
-        for (int i = 0; i < rows_; ++i) {
-            for (int j = 0; j < cols_; ++j) {
-                result.data[j][i] = data[i][j];
+    void transpose_into(Matrix& out) const {
+        if (&out == this) {
+            throw "Cannot transpose a matrix into itself";
+        }
+        out.reshape(cols_, rows_);
+        int tiles = (rows_ + TRANSPOSE_TILE - 1) / TRANSPOSE_TILE;
+        MatrixParallel::for_each_row_range(tiles, count(), MatrixParallel::MIN_ELEMENTS, [&](int, int first, int last) {
+            for (int ib = first * TRANSPOSE_TILE; ib < last * TRANSPOSE_TILE; ib += TRANSPOSE_TILE) {
+                int ie = ib + TRANSPOSE_TILE < rows_ ? ib + TRANSPOSE_TILE : rows_;
+                for (int jb = 0; jb < cols_; jb += TRANSPOSE_TILE) {
+                    int je = jb + TRANSPOSE_TILE < cols_ ? jb + TRANSPOSE_TILE : cols_;
+                    for (int i = ib; i < ie; ++i) {
+                        T* src = data_ + (long long)i * cols_;
+                        for (int j = jb; j < je; ++j) {
+                            out.data_[(long long)j * rows_ + i] = src[j];
+                        }
+                    }
+                }
             }
-        }
-        return result;
+        });
     }
 
-    Matrix operator+(Matrix& other) {
-        if (rows_ != other.rows_ || cols_ != other.cols_) {
-            throw "Matrix dimensions must match for addition";
+    static void multiply_into(const Matrix& A, const Matrix& B, Matrix& C) {
+        if (A.cols_ != B.rows_) {
+            throw "Matrix dimensions incompatible for multiplication";
         }
-        Matrix result(rows_, cols_);
-        for (int i = 0; i < rows_; ++i) {
-            for (int j = 0; j < cols_; ++j) {
-                result.data[i][j] = data[i][j] + other.data[i][j];
-            }
+        if (&C == &A || &C == &B) {
+            throw "Multiplication output must not alias an input";
         }
-        return result;
-    }
-
-    Matrix operator-(Matrix& other) {
-        if (rows_ != other.rows_ || cols_ != other.cols_) {
-            throw "Matrix dimensions must match for subtraction";
+        C.reshape(A.rows_, B.cols_);
+        C.fill(T());
+        if (C.data_ == nullptr || A.cols_ == 0) {
+            return;
         }
-        Matrix result(rows_, cols_);
-        for (int i = 0; i < rows_; ++i) {
-            for (int j = 0; j < cols_; ++j) {
-                result.data[i][j] = data[i][j] - other.data[i][j];
-            }
+        int m = A.rows_;
+        int k = A.cols_;
+        int n = B.cols_;
+        long long flops = (long long)m * k * n;
+        if (flops < GEMM_MIN_FLOPS) {
+            multiply_naive(A.data_, B.data_, C.data_, m, k, n);
+        } else {
+            multiply_blocked(A.data_, B.data_, C.data_, m, k, n);
         }
-        return result;
     }
 
-    Matrix operator*(Matrix& other) {
-        if (cols_ != other.rows_) {
-            throw "Matrix dimensions incompatible for multiplication";
+    void gram_into(Matrix& out) const {
+        if (&out == this) {
+            throw "Gram output must not alias the input";
         }
-        Matrix result(rows_, other.cols_);
-        for (int i = 0; i < rows_; ++i) {
-            for (int j = 0; j < other.cols_; ++j) {
-                T sum = T();
-                for (int k = 0; k < cols_; ++k) {
-                    sum = sum + (data[i][k] * other.data[k][j]);
+        out.reshape(cols_, cols_);
+        out.fill(T());
+        if (out.data_ == nullptr || rows_ == 0) {
+            return;
+        }
+        long long size = (long long)cols_ * cols_;
+        long long flops = (long long)rows_ * size / 2;
+        int threads = MatrixParallel::threads(rows_, flops, MatrixParallel::MIN_FLOPS);
+        T* partial = threads > 1 ? new T[(threads - 1) * size]() : nullptr;
+        Parallel::for_each_range(rows_, threads, [&](int worker, int begin, int end) {
+            T* g0 = worker == 0 ? out.data_ : partial + (worker - 1) * size;
+            for (int r = begin; r < end; ++r) {
+                T* x = data_ + (long long)r * cols_;
+                for (int a = 0; a < cols_; ++a) {
+                    T xa = x[a];
+                    T* g = g0 + (long long)a * cols_;
+                    for (int b = a; b < cols_; ++b) {
+                        g[b] = g[b] + xa * x[b];
+                    }
                 }
-                result.data[i][j] = sum;
+            }
+        });
+        for (int t = 1; t < threads; ++t) {
+            T* g = partial + (t - 1) * size;
+            for (long long i = 0; i < size; ++i) {
+                out.data_[i] = out.data_[i] + g[i];
             }
         }
-        return result;
-    }
-
-    Matrix scalar_multiply(const T& scalar) {
-        Matrix result(rows_, cols_);
-        for (int i = 0; i < rows_; ++i) {
-            for (int j = 0; j < cols_; ++j) {
-                result.data[i][j] = data[i][j] * scalar;
+        delete[] partial;
+        for (int a = 0; a < cols_; ++a) {
+            for (int b = 0; b < a; ++b) {
+                out.data_[(long long)a * cols_ + b] = out.data_[(long long)b * cols_ + a];
             }
         }
+    }
+
+    Matrix gram() const {
+        Matrix result;
+        gram_into(result);
         return result;
     }
 
     Matrix scalar_add(const T& scalar) {
         Matrix result(rows_, cols_);
-        for (int i = 0; i < rows_; ++i) {
-            for (int j = 0; j < cols_; ++j) {
-                result.data[i][j] = data[i][j] + scalar;
+        for_each_row_range([&](int, long long begin, long long end) {
+            for (long long i = begin; i < end; ++i) {
+                result.data_[i] = data_[i] + scalar;
             }
-        }
+        });
         return result;
     }
 
     Matrix scalar_subtract(const T& scalar) {
         Matrix result(rows_, cols_);
-        for (int i = 0; i < rows_; ++i) {
-            for (int j = 0; j < cols_; ++j) {
-                result.data[i][j] = data[i][j] - scalar;
+        for_each_row_range([&](int, long long begin, long long end) {
+            for (long long i = begin; i < end; ++i) {
+                result.data_[i] = data_[i] - scalar;
             }
-        }
+        });
         return result;
     }
 
-    Matrix operator*(const T& scalar) {
-        return scalar_multiply(scalar);
+    MatrixScaled<Matrix> operator*(const T& scalar) const {
+        return MatrixScaled<Matrix>(*this, scalar);
     }
 
     Matrix operator+(const T& scalar) {
@@ -211,21 +518,20 @@ public:
         return scalar_subtract(scalar);
     }
 
-    bool operator==(Matrix& other) {
+    bool operator==(const Matrix& other) const {
         if (rows_ != other.rows_ || cols_ != other.cols_) {
             return false;
         }
-        for (int i = 0; i < rows_; ++i) {
-            for (int j = 0; j < cols_; ++j) {
-                if (data[i][j] != other.data[i][j]) {
-                    return false;
-                }
+        long long n = count();
+        for (long long i = 0; i < n; ++i) {
+            if (data_[i] != other.data_[i]) {
+                return false;
             }
         }
         return true;
     }
 
-    bool operator!=(Matrix& other) {
+    bool operator!=(const Matrix& other) const {
         return !(*this == other);
     }
 
@@ -247,7 +553,7 @@ public:
                 if (j == exclude_col) {
                     continue;
                 }
-                result.data[result_row][result_col] = data[i][j];
+                result.data_[(long long)result_row * result.cols_ + result_col] = data_[(long long)i * cols_ + j];
                 ++result_col;
             }
             ++result_row;
@@ -259,33 +565,23 @@ public:
         if (!is_square()) {
             throw "Determinant can only be calculated for square matrices";
         }
+        if (rows_ == 0) {
+            return T(1);
+        }
         if (rows_ == 1) {
-            return data[0][0];
+            return data_[0];
         }
         if (rows_ == 2) {
-            return (data[0][0] * data[1][1]) - (data[0][1] * data[1][0]);
-        }
-        T det = T();
-        int sign = 1;
-        for (int j = 0; j < cols_; ++j) {
-            Matrix sub = get_submatrix(0, j);
-            T sub_det = sub.determinant();
-            det = det + (sign * data[0][j] * sub_det);
-            sign = -sign;
+            return (data_[0] * data_[3]) - (data_[1] * data_[2]);
         }
-        return det;
+        LuDecomposition<T> lu(*this);
+        return lu.determinant();
     }
 
     Matrix identity(int size) {
         Matrix result(size, size);
         for (int i = 0; i < size; ++i) {
-            for (int j = 0; j < size; ++j) {
-                if (i == j) {
-                    result.data[i][j] = T(1);
-                } else {
-                    result.data[i][j] = T(0);
-                }
-            }
+            result.data_[(long long)i * size + i] = T(1);
         }
         return result;
     }
@@ -311,21 +607,10 @@ public:
             return *this;
         }
         Matrix result = *this;
+        Matrix scratch;
         for (int i = 1; i < exponent; ++i) {
-            result = result * (*this);
-        }
-        return result;
-    }
-
-    Matrix element_wise_multiply(Matrix& other) {
-        if (rows_ != other.rows_ || cols_ != other.cols_) {
-            throw "Matrix dimensions must match for element-wise multiplication";
-        }
-        Matrix result(rows_, cols_);
-        for (int i = 0; i < rows_; ++i) {
-            for (int j = 0; j < cols_; ++j) {
-                result.data[i][j] = data[i][j] * other.data[i][j];
-            }
+            multiply_into(result, *this, scratch);
+            result.swap_storage(scratch);
         }
         return result;
     }
@@ -335,13 +620,24 @@ public:
             throw "Matrix dimensions must match for element-wise division";
         }
         Matrix result(rows_, cols_);
-        for (int i = 0; i < rows_; ++i) {
-            for (int j = 0; j < cols_; ++j) {
-                if (other.data[i][j] == T(0)) {
-                    throw "Division by zero in element-wise division";
+        int threads = row_range_threads();
+        bool* zero = new bool[threads]();
+        for_each_row_range([&](int worker, long long begin, long long end) {
+            for (long long i = begin; i < end; ++i) {
+                if (other.data_[i] == T(0)) {
+                    zero[worker] = true;
+                    return;
                 }
-                result.data[i][j] = data[i][j] / other.data[i][j];
+                result.data_[i] = data_[i] / other.data_[i];
             }
+        });
+        bool failed = false;
+        for (int t = 0; t < threads; ++t) {
+            failed = failed || zero[t];
+        }
+        delete[] zero;
+        if (failed) {
+            throw "Division by zero in element-wise division";
         }
         return result;
     }
@@ -352,18 +648,26 @@ public:
         }
         T sum = T();
         for (int i = 0; i < rows_; ++i) {
-            sum = sum + data[i][i];
+            sum = sum + data_[(long long)i * cols_ + i];
         }
         return sum;
     }
 
     T sum_all_elements() {
-        T sum = T();
-        for (int i = 0; i < rows_; ++i) {
-            for (int j = 0; j < cols_; ++j) {
-                sum = sum + data[i][j];
+        int threads = row_range_threads();
+        T* partial = new T[threads]();
+        for_each_row_range([&](int worker, long long begin, long long end) {
+            T sum = T();
+            for (long long i = begin; i < end; ++i) {
+                sum = sum + data_[i];
             }
+            partial[worker] = sum;
+        });
+        T sum = T();
+        for (int t = 0; t < threads; ++t) {
+            sum = sum + partial[t];
         }
+        delete[] partial;
         return sum;
     }
 
@@ -371,14 +675,27 @@ public:
         if (rows_ == 0 || cols_ == 0) {
             throw "Cannot find max element in empty matrix";
         }
-        T max_val = data[0][0];
-        for (int i = 0; i < rows_; ++i) {
-            for (int j = 0; j < cols_; ++j) {
-                if (data[i][j] > max_val) {
-                    max_val = data[i][j];
+        int threads = row_range_threads();
+        T* partial = new T[threads];
+        for (int t = 0; t < threads; ++t) {
+            partial[t] = data_[0];
+        }
+        for_each_row_range([&](int worker, long long begin, long long end) {
+            T max_val = data_[begin];
+            for (long long i = begin + 1; i < end; ++i) {
+                if (data_[i] > max_val) {
+                    max_val = data_[i];
                 }
             }
+            partial[worker] = max_val;
+        });
+        T max_val = partial[0];
+        for (int t = 1; t < threads; ++t) {
+            if (partial[t] > max_val) {
+                max_val = partial[t];
+            }
         }
+        delete[] partial;
         return max_val;
     }
 
@@ -386,14 +703,27 @@ public:
         if (rows_ == 0 || cols_ == 0) {
             throw "Cannot find min element in empty matrix";
         }
-        T min_val = data[0][0];
-        for (int i = 0; i < rows_; ++i) {
-            for (int j = 0; j < cols_; ++j) {
-                if (data[i][j] < min_val) {
-                    min_val = data[i][j];
+        int threads = row_range_threads();
+        T* partial = new T[threads];
+        for (int t = 0; t < threads; ++t) {
+            partial[t] = data_[0];
+        }
+        for_each_row_range([&](int worker, long long begin, long long end) {
+            T min_val = data_[begin];
+            for (long long i = begin + 1; i < end; ++i) {
+                if (data_[i] < min_val) {
+                    min_val = data_[i];
                 }
             }
+            partial[worker] = min_val;
+        });
+        T min_val = partial[0];
+        for (int t = 1; t < threads; ++t) {
+            if (partial[t] < min_val) {
+                min_val = partial[t];
+            }
         }
+        delete[] partial;
         return min_val;
     }
 
@@ -401,9 +731,10 @@ public:
         if (row_index < 0 || row_index >= rows_) {
             throw "Row index out of range";
         }
-        Vector<T> row;
+        Vector<T> row(cols_ + 1);
+        T* src = data_ + (long long)row_index * cols_;
         for (int j = 0; j < cols_; ++j) {
-            row.push_back(data[row_index][j]);
+            row.push_back(src[j]);
         }
         return row;
     }
@@ -412,9 +743,9 @@ public:
         if (col_index < 0 || col_index >= cols_) {
             throw "Column index out of range";
         }
-        Vector<T> col;
+        Vector<T> col(rows_ + 1);
         for (int i = 0; i < rows_; ++i) {
-            col.push_back(data[i][col_index]);
+            col.push_back(data_[(long long)i * cols_ + col_index]);
         }
         return col;
     }
@@ -426,8 +757,9 @@ public:
         if (row.size() != cols_) {
             throw "Row size must match matrix column size";
         }
+        T* dst = data_ + (long long)row_index * cols_;
         for (int j = 0; j < cols_; ++j) {
-            data[row_index][j] = row[j];
+            dst[j] = row[j];
         }
     }
 
@@ -439,7 +771,7 @@ public:
             throw "Column size must match matrix row size";
         }
         for (int i = 0; i < rows_; ++i) {
-            data[i][col_index] = col[i];
+            data_[(long long)i * cols_ + col_index] = col[i];
         }
     }
 
@@ -449,11 +781,14 @@ public:
         }
         Matrix result(rows_, cols_ + other.cols_);
         for (int i = 0; i < rows_; ++i) {
+            T* dst = result.data_ + (long long)i * result.cols_;
+            T* left = data_ + (long long)i * cols_;
+            T* right = other.data_ + (long long)i * other.cols_;
             for (int j = 0; j < cols_; ++j) {
-                result.data[i][j] = data[i][j];
+                dst[j] = left[j];
             }
             for (int j = 0; j < other.cols_; ++j) {
-                result.data[i][cols_ + j] = other.data[i][j];
+                dst[cols_ + j] = right[j];
             }
         }
         return result;
@@ -464,24 +799,21 @@ public:
             throw "Column count must match for vertical concatenation";
         }
         Matrix result(rows_ + other.rows_, cols_);
-        for (int i = 0; i < rows_; ++i) {
-            for (int j = 0; j < cols_; ++j) {
-                result.data[i][j] = data[i][j];
-            }
+        long long n = count();
+        long long m = other.count();
+        for (long long i = 0; i < n; ++i) {
+            result.data_[i] = data_[i];
         }
-        for (int i = 0; i < other.rows_; ++i) {
-            for (int j = 0; j < cols_; ++j) {
-                result.data[rows_ + i][j] = other.data[i][j];
-            }
+        for (long long i = 0; i < m; ++i) {
+            result.data_[n + i] = other.data_[i];
         }
         return result;
     }
 
     void fill(const T& value) {
-        for (int i = 0; i < rows_; ++i) {
-            for (int j = 0; j < cols_; ++j) {
-                data[i][j] = value;
-            }
+        long long n = count();
+        for (long long i = 0; i < n; ++i) {
+            data_[i] = value;
         }
     }
 
@@ -490,7 +822,7 @@ public:
             throw "Diagonal fill can only be done for square matrices";
         }
         for (int i = 0; i < rows_; ++i) {
-            data[i][i] = value;
+            data_[(long long)i * cols_ + i] = value;
         }
     }
 
@@ -498,8 +830,14 @@ public:
         if (!is_square()) {
             return false;
         }
-        Matrix transposed = transpose();
-        return (*this == transposed);
+        for (int i = 0; i < rows_; ++i) {
+            for (int j = i + 1; j < cols_; ++j) {
+                if (data_[(long long)i * cols_ + j] != data_[(long long)j * cols_ + i]) {
+                    return false;
+                }
+            }
+        }
+        return true;
     }
 
     bool is_diagonal() {
@@ -508,7 +846,7 @@ public:
         }
         for (int i = 0; i < rows_; ++i) {
             for (int j = 0; j < cols_; ++j) {
-                if (i != j && data[i][j] != T(0)) {
+                if (i != j && data_[(long long)i * cols_ + j] != T(0)) {
                     return false;
                 }
             }
@@ -522,7 +860,7 @@ public:
         }
         for (int i = 0; i < rows_; ++i) {
             for (int j = 0; j < i; ++j) {
-                if (data[i][j] != T(0)) {
+                if (data_[(long long)i * cols_ + j] != T(0)) {
                     return false;
                 }
             }
@@ -536,7 +874,7 @@ public:
         }
         for (int i = 0; i < rows_; ++i) {
             for (int j = i + 1; j < cols_; ++j) {
-                if (data[i][j] != T(0)) {
+                if (data_[(long long)i * cols_ + j] != T(0)) {
                     return false;
                 }
             }
@@ -551,10 +889,12 @@ public:
         if (row1 == row2) {
             return;
         }
+        T* a = data_ + (long long)row1 * cols_;
+        T* b = data_ + (long long)row2 * cols_;
         for (int j = 0; j < cols_; ++j) {
-            T temp = data[row1][j];
-            data[row1][j] = data[row2][j];
-            data[row2][j] = temp;
+            T temp = a[j];
+            a[j] = b[j];
+            b[j] = temp;
         }
     }
 
@@ -566,12 +906,14 @@ public:
             return;
         }
         for (int i = 0; i < rows_; ++i) {
-            T temp = data[i][col1];
-            data[i][col1] = data[i][col2];
-            data[i][col2] = temp;
+            T* r = data_ + (long long)i * cols_;
+            T temp = r[col1];
+            r[col1] = r[col2];
+            r[col2] = temp;
         }
     }
 };
 
-#endif
+#include "Decomposition.h"
 
+#endif
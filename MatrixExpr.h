@@ -0,0 +1,344 @@
+#ifndef MATRIX_EXPR_H
+#define MATRIX_EXPR_H
+
+#include "Parallel.h"
+
+using namespace std;
+
+template<typename T>
+class Matrix;
+
+template<typename E>
+class MatrixScaled;
+
+template<typename E>
+class MatrixTransposed;
+
+template<typename L, typename R, typename Op>
+class MatrixBinary;
+
+template<typename E>
+struct MatrixOperand {
+    typedef const E type;
+};
+
+template<typename T>
+struct MatrixOperand<Matrix<T>> {
+    typedef const Matrix<T>& type;
+};
+
+struct MatrixAddOp {
+    static const char* mismatch() {
+        return "Matrix dimensions must match for addition";
+    }
+    template<typename T>
+    static T apply(const T& a, const T& b) {
+        return a + b;
+    }
+};
+
+struct MatrixSubtractOp {
+    static const char* mismatch() {
+        return "Matrix dimensions must match for subtraction";
+    }
+    template<typename T>
+    static T apply(const T& a, const T& b) {
+        return a - b;
+    }
+};
+
+struct MatrixMultiplyOp {
+    static const char* mismatch() {
+        return "Matrix dimensions must match for element-wise multiplication";
+    }
+    template<typename T>
+    static T apply(const T& a, const T& b) {
+        return a * b;
+    }
+};
+
+class MatrixParallel {
+public:
+    static const long long MIN_ELEMENTS = 65536;
+    static const long long MIN_FLOPS = 4194304;
+
+    static int threads(int rows, long long work, long long min_work) {
+        long long wanted = work / min_work + 1;
+        if (wanted > rows) {
+            wanted = rows;
+        }
+        return Parallel::clamp_threads(0, (int)wanted);
+    }
+
+    template<typename Fn>
+    static void for_each_row_range(int rows, long long work, long long min_work, Fn fn) {
+        Parallel::for_each_range(rows, threads(rows, work, min_work), fn);
+    }
+};
+
+template<typename E>
+class MatrixExpr {
+public:
+    const E& derived() const {
+        return static_cast<const E&>(*this);
+    }
+
+    MatrixTransposed<E> transpose() const {
+        return MatrixTransposed<E>(derived());
+    }
+
+    template<typename S>
+    MatrixScaled<E> scalar_multiply(const S& scalar) const {
+        return MatrixScaled<E>(derived(), scalar);
+    }
+
+    template<typename R>
+    MatrixBinary<E, R, MatrixMultiplyOp> element_wise_multiply(const MatrixExpr<R>& other) const {
+        return MatrixBinary<E, R, MatrixMultiplyOp>(derived(), other.derived());
+    }
+
+    template<typename T>
+    void evaluate_into(Matrix<T>& out) const {
+        const E& e = derived();
+        int rows = e.rows();
+        int cols = e.cols();
+        out.reshape(rows, cols);
+        e.prepare();
+        T* dst = out.data();
+        MatrixParallel::for_each_row_range(rows, (long long)rows * cols, MatrixParallel::MIN_ELEMENTS, [&](int, int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                T* row = dst + (long long)i * cols;
+                for (int j = 0; j < cols; ++j) {
+                    row[j] = e.at(i, j);
+                }
+            }
+        });
+    }
+};
+
+template<typename L, typename R, typename Op>
+class MatrixBinary : public MatrixExpr<MatrixBinary<L, R, Op>> {
+private:
+    typename MatrixOperand<L>::type left_;
+    typename MatrixOperand<R>::type right_;
+
+public:
+    typedef typename L::value_type value_type;
+
+    MatrixBinary(const L& left, const R& right) : left_(left), right_(right) {
+        if (left_.rows() != right_.rows() || left_.cols() != right_.cols()) {
+            throw Op::mismatch();
+        }
+    }
+
+    int rows() const {
+        return left_.rows();
+    }
+
+    int cols() const {
+        return left_.cols();
+    }
+
+    value_type at(int i, int j) const {
+        return Op::apply(left_.at(i, j), right_.at(i, j));
+    }
+
+    bool references(const void* matrix) const {
+        return left_.references(matrix) || right_.references(matrix);
+    }
+
+    void prepare() const {
+        left_.prepare();
+        right_.prepare();
+    }
+};
+
+template<typename E>
+class MatrixScaled : public MatrixExpr<MatrixScaled<E>> {
+public:
+    typedef typename E::value_type value_type;
+
+private:
+    typename MatrixOperand<E>::type inner_;
+    value_type scalar_;
+
+public:
+    MatrixScaled(const E& inner, const value_type& scalar) : inner_(inner), scalar_(scalar) {}
+
+    int rows() const {
+        return inner_.rows();
+    }
+
+    int cols() const {
+        return inner_.cols();
+    }
+
+    value_type at(int i, int j) const {
+        return inner_.at(i, j) * scalar_;
+    }
+
+    bool references(const void* matrix) const {
+        return inner_.references(matrix);
+    }
+
+    void prepare() const {
+        inner_.prepare();
+    }
+};
+
+template<typename E>
+class MatrixTransposed : public MatrixExpr<MatrixTransposed<E>> {
+private:
+    static const int TILE = 32;
+
+    typename MatrixOperand<E>::type inner_;
+
+public:
+    typedef typename E::value_type value_type;
+
+    explicit MatrixTransposed(const E& inner) : inner_(inner) {}
+
+    const E& inner() const {
+        return inner_;
+    }
+
+    int rows() const {
+        return inner_.cols();
+    }
+
+    int cols() const {
+        return inner_.rows();
+    }
+
+    value_type at(int i, int j) const {
+        return inner_.at(j, i);
+    }
+
+    bool references(const void* matrix) const {
+        return inner_.references(matrix);
+    }
+
+    void prepare() const {
+        inner_.prepare();
+    }
+
+    void evaluate_into(Matrix<value_type>& out) const {
+        int rows = inner_.rows();
+        int cols = inner_.cols();
+        out.reshape(cols, rows);
+        inner_.prepare();
+        value_type* dst = out.data();
+        int tiles = (rows + TILE - 1) / TILE;
+        MatrixParallel::for_each_row_range(tiles, (long long)rows * cols, MatrixParallel::MIN_ELEMENTS, [&](int, int first, int last) {
+            for (int ib = first * TILE; ib < last * TILE; ib += TILE) {
+                int ie = ib + TILE < rows ? ib + TILE : rows;
+                for (int jb = 0; jb < cols; jb += TILE) {
+                    int je = jb + TILE < cols ? jb + TILE : cols;
+                    for (int i = ib; i < ie; ++i) {
+                        for (int j = jb; j < je; ++j) {
+                            dst[(long long)j * rows + i] = inner_.at(i, j);
+                        }
+                    }
+                }
+            }
+        });
+    }
+};
+
+class MatrixProductKernel {
+public:
+    template<typename T>
+    static void run(const Matrix<T>& a, const Matrix<T>& b, Matrix<T>& out) {
+        Matrix<T>::multiply_into(a, b, out);
+    }
+
+    template<typename T>
+    static void run(const MatrixTransposed<Matrix<T>>& a, const Matrix<T>& b, Matrix<T>& out) {
+        if (&a.inner() == &b) {
+            b.gram_into(out);
+            return;
+        }
+        Matrix<T> left;
+        a.inner().transpose_into(left);
+        Matrix<T>::multiply_into(left, b, out);
+    }
+
+    template<typename A, typename B, typename T>
+    static void run(const A& a, const B& b, Matrix<T>& out) {
+        Matrix<T> left(a);
+        Matrix<T> right(b);
+        Matrix<T>::multiply_into(left, right, out);
+    }
+};
+
+template<typename L, typename R>
+class MatrixProduct : public MatrixExpr<MatrixProduct<L, R>> {
+public:
+    typedef typename L::value_type value_type;
+
+private:
+    typename MatrixOperand<L>::type left_;
+    typename MatrixOperand<R>::type right_;
+    mutable Matrix<value_type> result_;
+    mutable bool ready_;
+
+    void materialize() const {
+        if (!ready_) {
+            MatrixProductKernel::run(left_, right_, result_);
+            ready_ = true;
+        }
+    }
+
+public:
+    MatrixProduct(const L& left, const R& right) : left_(left), right_(right), result_(), ready_(false) {
+        if (left_.cols() != right_.rows()) {
+            throw "Matrix dimensions incompatible for multiplication";
+        }
+    }
+
+    int rows() const {
+        return left_.rows();
+    }
+
+    int cols() const {
+        return right_.cols();
+    }
+
+    value_type at(int i, int j) const {
+        materialize();
+        return result_.at(i, j);
+    }
+
+    bool references(const void* matrix) const {
+        return left_.references(matrix) || right_.references(matrix);
+    }
+
+    void prepare() const {
+        materialize();
+    }
+
+    void evaluate_into(Matrix<value_type>& out) const {
+        if (ready_) {
+            out = result_;
+            return;
+        }
+        MatrixProductKernel::run(left_, right_, out);
+    }
+};
+
+template<typename L, typename R>
+MatrixBinary<L, R, MatrixAddOp> operator+(const MatrixExpr<L>& left, const MatrixExpr<R>& right) {
+    return MatrixBinary<L, R, MatrixAddOp>(left.derived(), right.derived());
+}
+
+template<typename L, typename R>
+MatrixBinary<L, R, MatrixSubtractOp> operator-(const MatrixExpr<L>& left, const MatrixExpr<R>& right) {
+    return MatrixBinary<L, R, MatrixSubtractOp>(left.derived(), right.derived());
+}
+
+template<typename L, typename R>
+MatrixProduct<L, R> operator*(const MatrixExpr<L>& left, const MatrixExpr<R>& right) {
+    return MatrixProduct<L, R>(left.derived(), right.derived());
+}
+
+#endif
@@ -0,0 +1,204 @@
+#ifndef METRIC_INDEX_H
+#define METRIC_INDEX_H
+
+#include "Vector.h"
+#include "Stock.h"
+#include "AVLTree.h"
+
+using namespace std;
+
+struct MetricKey {
+    double value;
+    Stock* ref;
+    bool operator<(const MetricKey& other) {
+        if (value != other.value) {
+            return value < other.value;
+        }
+        if (ref->company_name != other.ref->company_name) {
+            return ref->company_name < other.ref->company_name;
+        }
+        if (ref->year != other.ref->year) {
+            return ref->year < other.ref->year;
+        }
+        return ref < other.ref;
+    }
+    bool operator>(const MetricKey& other) {
+        if (value != other.value) {
+            return value > other.value;
+        }
+        if (ref->company_name != other.ref->company_name) {
+            return ref->company_name > other.ref->company_name;
+        }
+        if (ref->year != other.ref->year) {
+            return ref->year > other.ref->year;
+        }
+        return ref > other.ref;
+    }
+    bool operator<=(const MetricKey& other) {
+        return !(*this > other);
+    }
+    bool operator>=(const MetricKey& other) {
+        return !(*this < other);
+    }
+    bool operator==(const MetricKey& other) {
+        return ref == other.ref;
+    }
+    bool operator<(double metric_value) {
+        return value < metric_value;
+    }
+};
+
+inline bool operator<(double metric_value, const MetricKey& key) {
+    return metric_value < key.value;
+}
+
+class MetricIndexRegistry {
+private:
+    AVLTree<MetricKey>* indexes_[METRIC_COUNT];
+
+    MetricKey make_key(Stock* s, int metric_id) {
+        MetricKey key;
+        key.value = s->metric_value(metric_id);
+        key.ref = s;
+        return key;
+    }
+
+    void check_metric(int metric_id) {
+        if (metric_id < 0 || metric_id >= METRIC_COUNT) {
+            throw "Metric id out of range";
+        }
+    }
+
+public:
+    explicit MetricIndexRegistry() {
+        for (int m = 0; m < METRIC_COUNT; ++m) {
+            indexes_[m] = nullptr;
+        }
+    }
+
+    MetricIndexRegistry(const MetricIndexRegistry& other) = delete;
+    MetricIndexRegistry& operator=(const MetricIndexRegistry& other) = delete;
+
+    ~MetricIndexRegistry() {
+        for (int m = 0; m < METRIC_COUNT; ++m) {
+            delete indexes_[m];
+        }
+    }
+
+    void declare(int metric_id) {
+        check_metric(metric_id);
+        if (indexes_[metric_id] == nullptr) {
+            indexes_[metric_id] = new AVLTree<MetricKey>();
+        }
+    }
+
+    void drop(int metric_id) {
+        check_metric(metric_id);
+        delete indexes_[metric_id];
+        indexes_[metric_id] = nullptr;
+    }
+
+    bool has_index(int metric_id) {
+        return metric_id >= 0 && metric_id < METRIC_COUNT && indexes_[metric_id] != nullptr;
+    }
+
+    AVLTree<MetricKey>& index(int metric_id) {
+        if (!has_index(metric_id)) {
+            throw "No index declared for metric";
+        }
+        return *indexes_[metric_id];
+    }
+
+    void clear_entries() {
+        for (int m = 0; m < METRIC_COUNT; ++m) {
+            if (indexes_[m] != nullptr) {
+                *indexes_[m] = AVLTree<MetricKey>();
+            }
+        }
+    }
+
+    void build(Vector<Stock>& stocks, int metric_id) {
+        declare(metric_id);
+        *indexes_[metric_id] = AVLTree<MetricKey>();
+        for (int i = 0; i < stocks.size(); ++i) {
+            MetricKey key = make_key(&stocks[i], metric_id);
+            indexes_[metric_id]->insert(key);
+        }
+    }
+
+    void insert(Stock* s) {
+        for (int m = 0; m < METRIC_COUNT; ++m) {
+            if (indexes_[m] != nullptr) {
+                MetricKey key = make_key(s, m);
+                indexes_[m]->insert(key);
+            }
+        }
+    }
+
+    void remove(Stock* s) {
+        for (int m = 0; m < METRIC_COUNT; ++m) {
+            if (indexes_[m] != nullptr) {
+                MetricKey key = make_key(s, m);
+                indexes_[m]->remove(key);
+            }
+        }
+    }
+
+    void update(Stock* s, Stock& new_values) {
+        remove(s);
+        *s = new_values;
+        insert(s);
+    }
+
+    void range(int metric_id, double low, double high, Vector<Stock*>& out) {
+        index(metric_id).visit_range(low, high, [&out](MetricKey& key) {
+            out.push_back(key.ref);
+        });
+    }
+
+    void top_n(int metric_id, int n, bool highest, Vector<Stock*>& out) {
+        AVLTree<MetricKey>& tree = index(metric_id);
+        int total = tree.size();
+        if (n > total) {
+            n = total;
+        }
+        if (!highest) {
+            AVLTree<MetricKey>::Iterator it = tree.begin();
+            for (int i = 0; i < n && it.valid(); ++i, ++it) {
+                out.push_back(it->ref);
+            }
+            return;
+        }
+        AVLTree<MetricKey>::ReverseIterator it = tree.rbegin();
+        for (int i = 0; i < n && it.valid(); ++i, ++it) {
+            out.push_back(it->ref);
+        }
+    }
+
+    double percentile(int metric_id, double q) {
+        AVLTree<MetricKey>& tree = index(metric_id);
+        int n = tree.size();
+        if (n == 0) {
+            return 0.0;
+        }
+        if (q < 0.0) {
+            q = 0.0;
+        }
+        if (q > 1.0) {
+            q = 1.0;
+        }
+        int k = (int)(q * (double)(n - 1) + 0.5);
+        return tree.kth(k).value;
+    }
+
+    double percentile_rank(int metric_id, double value) {
+        AVLTree<MetricKey>& tree = index(metric_id);
+        int n = tree.size();
+        if (n == 0) {
+            return 0.0;
+        }
+        return (double)tree.rank(value) / (double)n;
+    }
+};
+
+#endif
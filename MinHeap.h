@@ -46,6 +46,46 @@ private:
         }
     }
 
+    bool frontier_before(int a, int b) {
+        return heap[a] < heap[b];
+    }
+
+    void frontier_up(int* frontier, int index) {
+        while (index > 0) {
+            int parent = (index - 1) / 2;
+            if (!frontier_before(frontier[index], frontier[parent])) {
+                break;
+            }
+            int temp = frontier[parent];
+            frontier[parent] = frontier[index];
+            frontier[index] = temp;
+            index = parent;
+        }
+    }
+
+    void frontier_down(int* frontier, int count, int index) {
+        while (true) {
+            int smallest = index;
+            int left = 2 * index + 1;
+            int right = 2 * index + 2;
+
+            if (left < count && frontier_before(frontier[left], frontier[smallest])) {
+                smallest = left;
+            }
+            if (right < count && frontier_before(frontier[right], frontier[smallest])) {
+                smallest = right;
+            }
+
+            if (smallest == index) {
+                break;
+            }
+            int temp = frontier[index];
+            frontier[index] = frontier[smallest];
+            frontier[smallest] = temp;
+            index = smallest;
+        }
+    }
+
 public:
     explicit MinHeap() {}
 
@@ -95,6 +135,36 @@ public:
         return heap[0];
     }
 
+    void top_k(int k, Vector<T>& out) {
+        int n = heap.size();
+        if (k > n) {
+            k = n;
+        }
+        if (k <= 0) {
+            return;
+        }
+        int* frontier = new int[k + 2];
+        int count = 0;
+        frontier[count++] = 0;
+        for (int taken = 0; taken < k; ++taken) {
+            int best = frontier[0];
+            out.push_back(heap[best]);
+            frontier[0] = frontier[--count];
+            frontier_down(frontier, count, 0);
+            int left = 2 * best + 1;
+            int right = 2 * best + 2;
+            if (left < n) {
+                frontier[count] = left;
+                frontier_up(frontier, count++);
+            }
+            if (right < n) {
+                frontier[count] = right;
+                frontier_up(frontier, count++);
+            }
+        }
+        delete[] frontier;
+    }
+
     bool empty() {
         return heap.empty();
     }
@@ -0,0 +1,49 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "ThreadPool.h"
+
+using namespace std;
+
+class Parallel {
+public:
+    static int default_threads() {
+        return ThreadPool::hardware_threads();
+    }
+
+    static int clamp_threads(int requested, int work_items) {
+        int n = requested;
+        if (n <= 0) {
+            n = default_threads();
+        }
+        if (n > work_items) {
+            n = work_items;
+        }
+        if (n < 1) {
+            n = 1;
+        }
+        return n;
+    }
+
+    template<typename Fn>
+    static void for_each_range(int count, int num_threads, Fn fn) {
+        if (count <= 0) {
+            return;
+        }
+        int n = clamp_threads(num_threads, count);
+        if (n == 1) {
+            fn(0, 0, count);
+            return;
+        }
+        int chunk = count / n;
+        int extra = count % n;
+        auto task = [&](int t) {
+            int begin = t * chunk + (t < extra ? t : extra);
+            int end = begin + chunk + (t < extra ? 1 : 0);
+            fn(t, begin, end);
+        };
+        ThreadPool::shared().run(n, task);
+    }
+};
+
+#endif
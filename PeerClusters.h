@@ -0,0 +1,341 @@
+#ifndef PEER_CLUSTERS_H
+#define PEER_CLUSTERS_H
+
+#include "Vector.h"
+#include "CsrGraph.h"
+#include "Parallel.h"
+#include <atomic>
+
+using namespace std;
+
+struct PeerAggregate {
+    int count;
+    double sum_pe;
+    double sum_roe;
+    double sum_div;
+
+    PeerAggregate() {
+        count = 0;
+        sum_pe = 0.0;
+        sum_roe = 0.0;
+        sum_div = 0.0;
+    }
+};
+
+class PeerClusters {
+private:
+    static const int MAX_PROPAGATION_ROUNDS = 20;
+    static const int MIN_VERTICES_PER_THREAD = 2048;
+
+    int num_vertices_;
+    int* component_;
+    int* community_;
+    int component_count_;
+    int community_count_;
+    int* member_offsets_;
+    int* members_;
+    int rounds_;
+
+    void release() {
+        delete[] component_;
+        delete[] community_;
+        delete[] member_offsets_;
+        delete[] members_;
+        component_ = nullptr;
+        community_ = nullptr;
+        member_offsets_ = nullptr;
+        members_ = nullptr;
+        num_vertices_ = 0;
+        component_count_ = 0;
+        community_count_ = 0;
+        rounds_ = 0;
+    }
+
+    static int find_root(std::atomic<int>* parent, int x) {
+        while (true) {
+            int p = parent[x].load(std::memory_order_relaxed);
+            if (p == x) {
+                return x;
+            }
+            int gp = parent[p].load(std::memory_order_relaxed);
+            if (p != gp) {
+                parent[x].compare_exchange_weak(p, gp, std::memory_order_relaxed);
+            }
+            x = gp;
+        }
+    }
+
+    static int label_slot(int* table, int mask, int label) {
+        int slot = (int)(((unsigned int)label * 2654435761u) & (unsigned int)mask);
+        while (table[2 * slot] != -1 && table[2 * slot] != label) {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    static void unite(std::atomic<int>* parent, int a, int b) {
+        while (true) {
+            a = find_root(parent, a);
+            b = find_root(parent, b);
+            if (a == b) {
+                return;
+            }
+            if (a < b) {
+                int t = a;
+                a = b;
+                b = t;
+            }
+            int expected = a;
+            if (parent[a].compare_exchange_strong(expected, b, std::memory_order_relaxed)) {
+                return;
+            }
+        }
+    }
+
+    static int relabel_dense(int* labels, int n) {
+        int* remap = new int[n + 1];
+        for (int v = 0; v < n; ++v) {
+            remap[v] = -1;
+        }
+        int next = 0;
+        for (int v = 0; v < n; ++v) {
+            int l = labels[v];
+            if (remap[l] < 0) {
+                remap[l] = next++;
+            }
+            labels[v] = remap[l];
+        }
+        delete[] remap;
+        return next;
+    }
+
+    void find_components(CsrGraph& graph, int threads) {
+        int n = num_vertices_;
+        std::atomic<int>* parent = new std::atomic<int>[n];
+        for (int v = 0; v < n; ++v) {
+            parent[v].store(v, std::memory_order_relaxed);
+        }
+        Parallel::for_each_range(n, threads, [&](int, int begin, int end) {
+            for (int v = begin; v < end; ++v) {
+                CsrGraph::Span adj = graph.neighbor_span(v);
+                for (int* it = adj.begin(); it != adj.end(); ++it) {
+                    if (*it < v) {
+                        unite(parent, v, *it);
+                    }
+                }
+            }
+        });
+        for (int v = 0; v < n; ++v) {
+            component_[v] = find_root(parent, v);
+        }
+        delete[] parent;
+        component_count_ = relabel_dense(component_, n);
+    }
+
+    void propagate_labels(CsrGraph& graph, int threads) {
+        int n = num_vertices_;
+        int* current = community_;
+        int* next = new int[n];
+        for (int v = 0; v < n; ++v) {
+            current[v] = v;
+        }
+        int* changes = new int[threads];
+        int max_degree = 0;
+        for (int v = 0; v < n; ++v) {
+            if (graph.degree(v) > max_degree) {
+                max_degree = graph.degree(v);
+            }
+        }
+        int capacity = 1;
+        while (capacity < 2 * (max_degree + 1)) {
+            capacity *= 2;
+        }
+        int* table_scratch = new int[(long long)threads * capacity * 2];
+        int* touched_scratch = new int[(long long)threads * capacity];
+        for (long long i = 0; i < (long long)threads * capacity * 2; i += 2) {
+            table_scratch[i] = -1;
+        }
+        rounds_ = 0;
+        while (rounds_ < MAX_PROPAGATION_ROUNDS) {
+            for (int t = 0; t < threads; ++t) {
+                changes[t] = 0;
+            }
+            Parallel::for_each_range(n, threads, [&](int worker, int begin, int end) {
+                int* table = table_scratch + (long long)worker * capacity * 2;
+                int* touched = touched_scratch + (long long)worker * capacity;
+                for (int v = begin; v < end; ++v) {
+                    int touched_count = 0;
+                    CsrGraph::Span adj = graph.neighbor_span(v);
+                    int mask = 1;
+                    while (mask + 1 < 2 * (adj.size() + 1)) {
+                        mask = mask * 2 + 1;
+                    }
+                    int run_label = current[v];
+                    int run = 1;
+                    int* it = adj.begin();
+                    int* stop = adj.end();
+                    while (true) {
+                        if (it != stop && current[*it] == run_label) {
+                            run++;
+                            ++it;
+                            continue;
+                        }
+                        int slot = label_slot(table, mask, run_label);
+                        if (table[2 * slot] == -1) {
+                            table[2 * slot] = run_label;
+                            table[2 * slot + 1] = 0;
+                            touched[touched_count++] = slot;
+                        }
+                        table[2 * slot + 1] += run;
+                        if (it == stop) {
+                            break;
+                        }
+                        run_label = current[*it];
+                        run = 1;
+                        ++it;
+                    }
+                    int best = current[v];
+                    int best_count = 0;
+                    for (int i = 0; i < touched_count; ++i) {
+                        int slot = touched[i];
+                        int l = table[2 * slot];
+                        int count = table[2 * slot + 1];
+                        if (count > best_count || (count == best_count && l < best)) {
+                            best = l;
+                            best_count = count;
+                        }
+                        table[2 * slot] = -1;
+                    }
+                    next[v] = best;
+                    if (best != current[v]) {
+                        changes[worker]++;
+                    }
+                }
+            });
+            int* t = current;
+            current = next;
+            next = t;
+            rounds_++;
+            int total = 0;
+            for (int w = 0; w < threads; ++w) {
+                total += changes[w];
+            }
+            if (total == 0) {
+                break;
+            }
+        }
+        if (current != community_) {
+            for (int v = 0; v < n; ++v) {
+                community_[v] = current[v];
+            }
+            delete[] current;
+        } else {
+            delete[] next;
+        }
+        delete[] changes;
+        delete[] table_scratch;
+        delete[] touched_scratch;
+        community_count_ = relabel_dense(community_, n);
+    }
+
+    void index_members() {
+        int n = num_vertices_;
+        member_offsets_ = new int[community_count_ + 1];
+        members_ = new int[n + 1];
+        for (int c = 0; c <= community_count_; ++c) {
+            member_offsets_[c] = 0;
+        }
+        for (int v = 0; v < n; ++v) {
+            member_offsets_[community_[v] + 1]++;
+        }
+        for (int c = 0; c < community_count_; ++c) {
+            member_offsets_[c + 1] += member_offsets_[c];
+        }
+        int* cursor = new int[community_count_ + 1];
+        for (int c = 0; c < community_count_; ++c) {
+            cursor[c] = member_offsets_[c];
+        }
+        for (int v = 0; v < n; ++v) {
+            members_[cursor[community_[v]]++] = v;
+        }
+        delete[] cursor;
+    }
+
+public:
+    explicit PeerClusters()
+        : num_vertices_(0), component_(nullptr), community_(nullptr), component_count_(0), community_count_(0),
+          member_offsets_(nullptr), members_(nullptr), rounds_(0) {}
+
+    PeerClusters(const PeerClusters& other) = delete;
+    PeerClusters& operator=(const PeerClusters& other) = delete;
+
+    ~PeerClusters() {
+        release();
+    }
+
+    void clear() {
+        release();
+    }
+
+    void build(CsrGraph& graph, int num_threads = 0) {
+        release();
+        int n = graph.num_vertices();
+        num_vertices_ = n;
+        component_ = new int[n + 1];
+        community_ = new int[n + 1];
+        if (n == 0) {
+            index_members();
+            return;
+        }
+        int threads = Parallel::clamp_threads(num_threads, n / MIN_VERTICES_PER_THREAD + 1);
+        find_components(graph, threads);
+        propagate_labels(graph, threads);
+        index_members();
+    }
+
+    int size() {
+        return num_vertices_;
+    }
+
+    int component_count() {
+        return component_count_;
+    }
+
+    int community_count() {
+        return community_count_;
+    }
+
+    int rounds() {
+        return rounds_;
+    }
+
+    int component(int vertex) {
+        if (vertex < 0 || vertex >= num_vertices_) {
+            throw "Vertex index out of range";
+        }
+        return component_[vertex];
+    }
+
+    int community(int vertex) {
+        if (vertex < 0 || vertex >= num_vertices_) {
+            throw "Vertex index out of range";
+        }
+        return community_[vertex];
+    }
+
+    int* communities() {
+        return community_;
+    }
+
+    CsrGraph::Span members(int community_id) {
+        if (community_id < 0 || community_id >= community_count_) {
+            throw "Community id out of range";
+        }
+        CsrGraph::Span span;
+        span.data = members_ + member_offsets_[community_id];
+        span.count = member_offsets_[community_id + 1] - member_offsets_[community_id];
+        return span;
+    }
+};
+
+#endif
@@ -0,0 +1,311 @@
+#ifndef SCAN_KERNELS_H
+#define SCAN_KERNELS_H
+
+#include "Vector.h"
+#include "CpuFeatures.h"
+
+using namespace std;
+
+enum PredicateOp {
+    PRED_RANGE = 0,
+    PRED_GREATER = 1,
+    PRED_LESS = 2
+};
+
+// PRED_RANGE reads [low, high]; PRED_GREATER reads only low; PRED_LESS reads only high.
+struct MetricPredicate {
+    int metric;
+    int op;
+    double low;
+    double high;
+};
+
+class SelectionBitmap {
+private:
+    unsigned long long* words_;
+    int size_;
+    int word_count_;
+
+public:
+    explicit SelectionBitmap(int size = 0) : words_(nullptr), size_(0), word_count_(0) {
+        resize(size);
+    }
+
+    SelectionBitmap(const SelectionBitmap& other) : words_(nullptr), size_(0), word_count_(0) {
+        resize(other.size_);
+        for (int w = 0; w < word_count_; ++w) {
+            words_[w] = other.words_[w];
+        }
+    }
+
+    SelectionBitmap& operator=(const SelectionBitmap& other) {
+        if (this != &other) {
+            resize(other.size_);
+            for (int w = 0; w < word_count_; ++w) {
+                words_[w] = other.words_[w];
+            }
+        }
+        return *this;
+    }
+
+    ~SelectionBitmap() {
+        delete[] words_;
+    }
+
+    void resize(int size) {
+        int needed = (size + 63) / 64;
+        if (needed != word_count_) {
+            delete[] words_;
+            words_ = nullptr;
+            if (needed > 0) {
+                words_ = new unsigned long long[needed];
+            }
+            word_count_ = needed;
+        }
+        size_ = size;
+        clear();
+    }
+
+    void clear() {
+        for (int w = 0; w < word_count_; ++w) {
+            words_[w] = 0ULL;
+        }
+    }
+
+    int size() {
+        return size_;
+    }
+
+    int word_count() {
+        return word_count_;
+    }
+
+    unsigned long long* words() {
+        return words_;
+    }
+
+    bool test(int index) {
+        return ((words_[index >> 6] >> (index & 63)) & 1ULL) != 0;
+    }
+
+    void and_with(SelectionBitmap& other) {
+        if (other.size_ != size_) {
+            throw "Bitmap sizes must match";
+        }
+        for (int w = 0; w < word_count_; ++w) {
+            words_[w] &= other.words_[w];
+        }
+    }
+
+    void or_with(SelectionBitmap& other) {
+        if (other.size_ != size_) {
+            throw "Bitmap sizes must match";
+        }
+        for (int w = 0; w < word_count_; ++w) {
+            words_[w] |= other.words_[w];
+        }
+    }
+
+    int count() {
+        int total = 0;
+        for (int w = 0; w < word_count_; ++w) {
+            total += popcount(words_[w]);
+        }
+        return total;
+    }
+
+    void to_indices(Vector<int>& out) {
+        for (int w = 0; w < word_count_; ++w) {
+            unsigned long long bits = words_[w];
+            while (bits != 0ULL) {
+                out.push_back(w * 64 + trailing_zeros(bits));
+                bits &= bits - 1ULL;
+            }
+        }
+    }
+
+    static int popcount(unsigned long long x) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_popcountll(x);
+#else
+        int c = 0;
+        while (x != 0ULL) {
+            x &= x - 1ULL;
+            c++;
+        }
+        return c;
+#endif
+    }
+
+    static int trailing_zeros(unsigned long long x) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(x);
+#else
+        int n = 0;
+        while ((x & 1ULL) == 0ULL) {
+            x >>= 1;
+            n++;
+        }
+        return n;
+#endif
+    }
+};
+
+class ScanKernels {
+private:
+    template<int OP>
+    static bool match(double v, double low, double high) {
+        if (OP == PRED_RANGE) {
+            return v >= low && v <= high;
+        }
+        if (OP == PRED_GREATER) {
+            return v > low;
+        }
+        return v < high;
+    }
+
+    template<int OP>
+    static void filter_tail(const double* col, int begin, int n, double low, double high, unsigned long long* words) {
+        if (begin >= n) {
+            return;
+        }
+        unsigned long long bits = 0ULL;
+        for (int i = begin; i < n; ++i) {
+            if (match<OP>(col[i], low, high)) {
+                bits |= 1ULL << (i - begin);
+            }
+        }
+        words[begin >> 6] = bits;
+    }
+
+    template<int OP>
+    static void filter_scalar(const double* col, int n, double low, double high, unsigned long long* words) {
+        int full = n / 64;
+        for (int w = 0; w < full; ++w) {
+            const double* p = col + w * 64;
+            unsigned long long bits = 0ULL;
+            for (int k = 0; k < 64; ++k) {
+                bits |= (unsigned long long)match<OP>(p[k], low, high) << k;
+            }
+            words[w] = bits;
+        }
+        filter_tail<OP>(col, full * 64, n, low, high, words);
+    }
+
+#ifdef CPU_FEATURES_X86
+    template<int OP>
+    TARGET_SSE2 static void filter_sse2(const double* col, int n, double low, double high, unsigned long long* words) {
+        __m128d vlow = _mm_set1_pd(low);
+        __m128d vhigh = _mm_set1_pd(high);
+        int full = n / 64;
+        for (int w = 0; w < full; ++w) {
+            const double* p = col + w * 64;
+            unsigned long long bits = 0ULL;
+            for (int k = 0; k < 32; ++k) {
+                __m128d v = _mm_loadu_pd(p + k * 2);
+                __m128d m;
+                if (OP == PRED_RANGE) {
+                    m = _mm_and_pd(_mm_cmpge_pd(v, vlow), _mm_cmple_pd(v, vhigh));
+                } else if (OP == PRED_GREATER) {
+                    m = _mm_cmpgt_pd(v, vlow);
+                } else {
+                    m = _mm_cmplt_pd(v, vhigh);
+                }
+                bits |= (unsigned long long)_mm_movemask_pd(m) << (k * 2);
+            }
+            words[w] = bits;
+        }
+        filter_tail<OP>(col, full * 64, n, low, high, words);
+    }
+
+    template<int OP>
+    TARGET_AVX2 static void filter_avx2(const double* col, int n, double low, double high, unsigned long long* words) {
+        __m256d vlow = _mm256_set1_pd(low);
+        __m256d vhigh = _mm256_set1_pd(high);
+        int full = n / 64;
+        for (int w = 0; w < full; ++w) {
+            const double* p = col + w * 64;
+            unsigned long long bits = 0ULL;
+            for (int k = 0; k < 16; ++k) {
+                __m256d v = _mm256_loadu_pd(p + k * 4);
+                __m256d m;
+                if (OP == PRED_RANGE) {
+                    m = _mm256_and_pd(_mm256_cmp_pd(v, vlow, _CMP_GE_OQ), _mm256_cmp_pd(v, vhigh, _CMP_LE_OQ));
+                } else if (OP == PRED_GREATER) {
+                    m = _mm256_cmp_pd(v, vlow, _CMP_GT_OQ);
+                } else {
+                    m = _mm256_cmp_pd(v, vhigh, _CMP_LT_OQ);
+                }
+                bits |= (unsigned long long)_mm256_movemask_pd(m) << (k * 4);
+            }
+            words[w] = bits;
+        }
+        filter_tail<OP>(col, full * 64, n, low, high, words);
+    }
+#endif
+
+    template<int OP>
+    static void dispatch(const double* col, int n, double low, double high, unsigned long long* words) {
+#ifdef CPU_FEATURES_X86
+        if (isa() == ISA_AVX2) {
+            filter_avx2<OP>(col, n, low, high, words);
+            return;
+        }
+        if (isa() == ISA_SSE2) {
+            filter_sse2<OP>(col, n, low, high, words);
+            return;
+        }
+#endif
+        filter_scalar<OP>(col, n, low, high, words);
+    }
+
+public:
+    static const int ISA_SCALAR = 0;
+    static const int ISA_SSE2 = 1;
+    static const int ISA_AVX2 = 2;
+
+    static int& isa() {
+        static int selected = CpuFeatures::has_avx2() ? ISA_AVX2 : (CpuFeatures::has_sse2() ? ISA_SSE2 : ISA_SCALAR);
+        return selected;
+    }
+
+    static const char* isa_name() {
+        if (isa() == ISA_AVX2) {
+            return "avx2";
+        }
+        if (isa() == ISA_SSE2) {
+            return "sse2";
+        }
+        return "scalar";
+    }
+
+    static void filter(const double* col, int n, int op, double low, double high, SelectionBitmap& out) {
+        out.resize(n);
+        if (n == 0) {
+            return;
+        }
+        if (op == PRED_RANGE) {
+            dispatch<PRED_RANGE>(col, n, low, high, out.words());
+        } else if (op == PRED_GREATER) {
+            dispatch<PRED_GREATER>(col, n, low, high, out.words());
+        } else if (op == PRED_LESS) {
+            dispatch<PRED_LESS>(col, n, low, high, out.words());
+        } else {
+            throw "Unknown predicate op";
+        }
+    }
+
+    static void filter_range(const double* col, int n, double low, double high, SelectionBitmap& out) {
+        filter(col, n, PRED_RANGE, low, high, out);
+    }
+
+    static void filter_greater(const double* col, int n, double threshold, SelectionBitmap& out) {
+        filter(col, n, PRED_GREATER, threshold, threshold, out);
+    }
+
+    static void filter_less(const double* col, int n, double threshold, SelectionBitmap& out) {
+        filter(col, n, PRED_LESS, threshold, threshold, out);
+    }
+};
+
+#endif
@@ -0,0 +1,216 @@
+#ifndef SECTOR_AGGREGATE_CACHE_H
+#define SECTOR_AGGREGATE_CACHE_H
+
+#include "Vector.h"
+#include "Stock.h"
+#include "StockTable.h"
+#include <cmath>
+
+using namespace std;
+
+enum SectorFlag {
+    SECTOR_NO_DATA = 1,
+    SECTOR_PE_BELOW = 2,
+    SECTOR_ROE_BELOW = 4,
+    SECTOR_DIV_BELOW = 8
+};
+
+struct SectorAggregate {
+    int count;
+    double sum_pe;
+    double sum_pe_sq;
+    double sum_roe;
+    double sum_roe_sq;
+    double sum_div;
+    double sum_div_sq;
+    double min_price;
+    double max_price;
+    bool extremes_dirty;
+
+    SectorAggregate() {
+        count = 0;
+        sum_pe = 0.0;
+        sum_pe_sq = 0.0;
+        sum_roe = 0.0;
+        sum_roe_sq = 0.0;
+        sum_div = 0.0;
+        sum_div_sq = 0.0;
+        min_price = 1e18;
+        max_price = -1e18;
+        extremes_dirty = false;
+    }
+
+    double mean_pe() {
+        return count > 0 ? sum_pe / (double)count : 0.0;
+    }
+
+    double mean_roe() {
+        return count > 0 ? sum_roe / (double)count : 0.0;
+    }
+
+    double mean_div() {
+        return count > 0 ? sum_div / (double)count : 0.0;
+    }
+
+    static double stddev(double sum, double sum_sq, int n) {
+        if (n <= 0) {
+            return 0.0;
+        }
+        double mean = sum / (double)n;
+        double var = sum_sq / (double)n - mean * mean;
+        return var > 0.0 ? sqrt(var) : 0.0;
+    }
+};
+
+class SectorAggregateCache {
+private:
+    Vector<SectorAggregate> sectors_;
+
+    void ensure_sector(int sector_id) {
+        while (sectors_.size() <= sector_id) {
+            sectors_.push_back(SectorAggregate());
+        }
+    }
+
+    static void accumulate(SectorAggregate& agg, double pe, double roe, double div, double sign) {
+        agg.sum_pe += sign * pe;
+        agg.sum_pe_sq += sign * pe * pe;
+        agg.sum_roe += sign * roe;
+        agg.sum_roe_sq += sign * roe * roe;
+        agg.sum_div += sign * div;
+        agg.sum_div_sq += sign * div * div;
+    }
+
+    void refresh_extremes(int sector_id, StockTable& table) {
+        SectorAggregate& agg = sectors_[sector_id];
+        agg.min_price = 1e18;
+        agg.max_price = -1e18;
+        int* sector_col = table.sector_ids();
+        double* price_col = table.column(METRIC_PRICE);
+        for (int i = 0; i < table.size(); ++i) {
+            if (sector_col[i] == sector_id) {
+                if (price_col[i] < agg.min_price) {
+                    agg.min_price = price_col[i];
+                }
+                if (price_col[i] > agg.max_price) {
+                    agg.max_price = price_col[i];
+                }
+            }
+        }
+        agg.extremes_dirty = false;
+    }
+
+public:
+    explicit SectorAggregateCache() : sectors_() {}
+
+    void clear() {
+        sectors_.clear();
+    }
+
+    void build(StockTable& table) {
+        sectors_.clear();
+        ensure_sector(table.sector_count() - 1);
+        int* sector_col = table.sector_ids();
+        double* pe_col = table.column(METRIC_PE);
+        double* roe_col = table.column(METRIC_ROE);
+        double* div_col = table.column(METRIC_DIVIDEND_YIELD);
+        double* price_col = table.column(METRIC_PRICE);
+        for (int i = 0; i < table.size(); ++i) {
+            SectorAggregate& agg = sectors_[sector_col[i]];
+            agg.count++;
+            accumulate(agg, pe_col[i], roe_col[i], div_col[i], 1.0);
+            if (price_col[i] < agg.min_price) {
+                agg.min_price = price_col[i];
+            }
+            if (price_col[i] > agg.max_price) {
+                agg.max_price = price_col[i];
+            }
+        }
+    }
+
+    void add_row(int sector_id, double pe, double roe, double div, double price) {
+        ensure_sector(sector_id);
+        SectorAggregate& agg = sectors_[sector_id];
+        agg.count++;
+        accumulate(agg, pe, roe, div, 1.0);
+        if (!agg.extremes_dirty) {
+            if (price < agg.min_price) {
+                agg.min_price = price;
+            }
+            if (price > agg.max_price) {
+                agg.max_price = price;
+            }
+        }
+    }
+
+    void update_row(int sector_id, Stock& before, Stock& after) {
+        ensure_sector(sector_id);
+        SectorAggregate& agg = sectors_[sector_id];
+        accumulate(agg, before.pe, before.roe, before.dividend_yield, -1.0);
+        accumulate(agg, after.pe, after.roe, after.dividend_yield, 1.0);
+        if (agg.extremes_dirty) {
+            return;
+        }
+        if (before.price == agg.min_price || before.price == agg.max_price) {
+            agg.extremes_dirty = true;
+            return;
+        }
+        if (after.price < agg.min_price) {
+            agg.min_price = after.price;
+        }
+        if (after.price > agg.max_price) {
+            agg.max_price = after.price;
+        }
+    }
+
+    int size() {
+        return sectors_.size();
+    }
+
+    bool has_sector(int sector_id) {
+        return sector_id >= 0 && sector_id < sectors_.size() && sectors_[sector_id].count > 0;
+    }
+
+    SectorAggregate& get(int sector_id, StockTable& table) {
+        if (sector_id < 0 || sector_id >= sectors_.size()) {
+            throw "Sector id out of range";
+        }
+        if (sectors_[sector_id].extremes_dirty) {
+            refresh_extremes(sector_id, table);
+        }
+        return sectors_[sector_id];
+    }
+
+    int flags(int sector_id, double pe, double roe, double div) {
+        if (!has_sector(sector_id)) {
+            return SECTOR_NO_DATA;
+        }
+        SectorAggregate& agg = sectors_[sector_id];
+        int f = 0;
+        if (pe < agg.mean_pe()) {
+            f |= SECTOR_PE_BELOW;
+        }
+        if (roe < agg.mean_roe()) {
+            f |= SECTOR_ROE_BELOW;
+        }
+        if (div < agg.mean_div()) {
+            f |= SECTOR_DIV_BELOW;
+        }
+        return f;
+    }
+
+    void flag_rows(StockTable& table, Vector<int>& out) {
+        int n = table.size();
+        out.clear();
+        out.reserve(n + 1);
+        int* sector_col = table.sector_ids();
+        double* pe_col = table.column(METRIC_PE);
+        double* roe_col = table.column(METRIC_ROE);
+        double* div_col = table.column(METRIC_DIVIDEND_YIELD);
+        for (int i = 0; i < n; ++i) {
+            out.push_back(flags(sector_col[i], pe_col[i], roe_col[i], div_col[i]));
+        }
+    }
+};
+
+#endif
@@ -6,9 +6,40 @@
 
 using namespace std;
 
+enum StockMetric {
+    METRIC_LATEST_EPS = 0,
+    METRIC_PE = 1,
+    METRIC_BOOK_VALUE = 2,
+    METRIC_ROE = 3,
+    METRIC_LAST_DIVIDEND = 4,
+    METRIC_PRICE = 5,
+    METRIC_EXPECTED_GROWTH = 6,
+    METRIC_DIVIDEND_YIELD = 7,
+    METRIC_EPS_LAST_QUARTER = 8,
+    METRIC_LAST_ANNUAL_EPS = 9,
+    METRIC_EXPECTED_PE = 10,
+    METRIC_PEG = 11,
+    METRIC_EXPECTED_BOOK_VALUE = 12,
+    METRIC_PB = 13,
+    METRIC_EXPECTED_PB = 14,
+    METRIC_EXPECTED_ROE = 15,
+    METRIC_EQUITY_TO_ASSET = 16,
+    METRIC_ROA = 17,
+    METRIC_EXPECTED_DIVIDEND = 18,
+    METRIC_PEG_RATIO = 19,
+    METRIC_BOOK_VALUE_GROWTH = 20,
+    METRIC_ASSET_RETURN = 21,
+    METRIC_COUNT = 22
+};
+
+const unsigned short NO_SECTOR = 0xFFFF;
+const int MAX_SECTORS = 0xFFFF;
+
 struct Stock {
     string company_name;
     string sector;
+    int company_id;
+    unsigned short sector_id;
     int year;
     double price;
     double latest_eps;
@@ -39,6 +70,8 @@ struct Stock {
     Stock() {
         company_name = "";
         sector = "";
+        company_id = -1;
+        sector_id = NO_SECTOR;
         year = 0;
         price = 0.0;
         latest_eps = 0.0;
@@ -65,6 +98,34 @@ struct Stock {
         valid = false;
     }
 
+    double metric_value(int id) {
+        switch (id) {
+            case METRIC_LATEST_EPS: return latest_eps;
+            case METRIC_PE: return pe;
+            case METRIC_BOOK_VALUE: return book_value;
+            case METRIC_ROE: return roe;
+            case METRIC_LAST_DIVIDEND: return last_dividend;
+            case METRIC_PRICE: return price;
+            case METRIC_EXPECTED_GROWTH: return expected_growth;
+            case METRIC_DIVIDEND_YIELD: return dividend_yield;
+            case METRIC_EPS_LAST_QUARTER: return eps_last_quarter;
+            case METRIC_LAST_ANNUAL_EPS: return last_annual_eps;
+            case METRIC_EXPECTED_PE: return expected_pe;
+            case METRIC_PEG: return peg;
+            case METRIC_EXPECTED_BOOK_VALUE: return expected_book_value;
+            case METRIC_PB: return pb;
+            case METRIC_EXPECTED_PB: return expected_pb;
+            case METRIC_EXPECTED_ROE: return expected_roe;
+            case METRIC_EQUITY_TO_ASSET: return equity_to_asset;
+            case METRIC_ROA: return roa;
+            case METRIC_EXPECTED_DIVIDEND: return expected_dividend;
+            case METRIC_PEG_RATIO: return peg_ratio;
+            case METRIC_BOOK_VALUE_GROWTH: return book_value_growth;
+            case METRIC_ASSET_RETURN: return asset_return;
+        }
+        return 0.0;
+    }
+
     void compute_derived() {
         if (price > 0.0 && last_dividend != 0.0) {
             dividend_yield = (last_dividend / price) * 100.0;
@@ -0,0 +1,250 @@
+#ifndef STOCK_TABLE_H
+#define STOCK_TABLE_H
+
+#include "Vector.h"
+#include "Stock.h"
+#include "SymbolTable.h"
+#include <string>
+#include <string_view>
+#include <new>
+
+using namespace std;
+
+class StockTable {
+private:
+    static const int ALIGNMENT = 64;
+    static const int KEY_BUFFER_SIZE = 128;
+
+    int size_;
+    int capacity_;
+    double* columns_[METRIC_COUNT];
+    int* year_;
+    int* company_id_;
+    int* sector_id_;
+    SymbolTable companies_;
+    SymbolTable sectors_;
+
+    template<typename U>
+    static U* allocate_column(int count) {
+        if (count <= 0) {
+            return nullptr;
+        }
+        return static_cast<U*>(::operator new(sizeof(U) * (size_t)count, std::align_val_t(ALIGNMENT)));
+    }
+
+    template<typename U>
+    static void free_column(U* column) {
+        if (column != nullptr) {
+            ::operator delete(column, std::align_val_t(ALIGNMENT));
+        }
+    }
+
+    void release() {
+        for (int m = 0; m < METRIC_COUNT; ++m) {
+            free_column(columns_[m]);
+            columns_[m] = nullptr;
+        }
+        free_column(year_);
+        free_column(company_id_);
+        free_column(sector_id_);
+        year_ = nullptr;
+        company_id_ = nullptr;
+        sector_id_ = nullptr;
+        size_ = 0;
+        capacity_ = 0;
+    }
+
+    void allocate(int capacity) {
+        release();
+        capacity_ = capacity;
+        for (int m = 0; m < METRIC_COUNT; ++m) {
+            columns_[m] = allocate_column<double>(capacity);
+        }
+        year_ = allocate_column<int>(capacity);
+        company_id_ = allocate_column<int>(capacity);
+        sector_id_ = allocate_column<int>(capacity);
+    }
+
+    template<typename U>
+    static U* grow_column(U* column, int count, int new_capacity) {
+        U* grown = allocate_column<U>(new_capacity);
+        for (int i = 0; i < count; ++i) {
+            grown[i] = column[i];
+        }
+        free_column(column);
+        return grown;
+    }
+
+    void grow(int new_capacity) {
+        for (int m = 0; m < METRIC_COUNT; ++m) {
+            columns_[m] = grow_column(columns_[m], size_, new_capacity);
+        }
+        year_ = grow_column(year_, size_, new_capacity);
+        company_id_ = grow_column(company_id_, size_, new_capacity);
+        sector_id_ = grow_column(sector_id_, size_, new_capacity);
+        capacity_ = new_capacity;
+    }
+
+    void write_row(int row, Stock& s) {
+        for (int m = 0; m < METRIC_COUNT; ++m) {
+            columns_[m][row] = s.metric_value(m);
+        }
+        year_[row] = s.year;
+        s.company_id = companies_.intern(s.company_name);
+        s.sector_id = (unsigned short)intern_sector(s.sector);
+        company_id_[row] = s.company_id;
+        sector_id_[row] = s.sector_id;
+    }
+
+    int intern_sector(const string& sector) {
+        char buffer[KEY_BUFFER_SIZE];
+        int len = normalize_into(sector, buffer, KEY_BUFFER_SIZE);
+        int id;
+        if (len >= 0) {
+            id = sectors_.intern(string_view(buffer, len));
+        } else {
+            id = sectors_.intern(normalize_key(sector));
+        }
+        if (id >= MAX_SECTORS) {
+            throw "Too many sectors for 16-bit sector ids";
+        }
+        return id;
+    }
+
+public:
+    explicit StockTable() : size_(0), capacity_(0), year_(nullptr), company_id_(nullptr), sector_id_(nullptr) {
+        for (int m = 0; m < METRIC_COUNT; ++m) {
+            columns_[m] = nullptr;
+        }
+    }
+
+    StockTable(const StockTable& other) = delete;
+    StockTable& operator=(const StockTable& other) = delete;
+
+    ~StockTable() {
+        release();
+    }
+
+    static bool is_space(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    static int normalize_into(string_view s, char* out, int capacity) {
+        int start = 0;
+        while (start < (int)s.size() && is_space(s[start])) {
+            start++;
+        }
+        int end = (int)s.size() - 1;
+        while (end >= start && is_space(s[end])) {
+            end--;
+        }
+        int len = end - start + 1;
+        if (len > capacity) {
+            return -1;
+        }
+        for (int i = 0; i < len; ++i) {
+            char c = s[start + i];
+            if (c >= 'a' && c <= 'z') {
+                c = (char)(c - 'a' + 'A');
+            }
+            out[i] = c;
+        }
+        return len;
+    }
+
+    static string normalize_key(const string& s) {
+        string out(s.size(), ' ');
+        int len = normalize_into(s, &out[0], (int)s.size());
+        out.resize(len);
+        return out;
+    }
+
+    void clear() {
+        release();
+        companies_.clear();
+        sectors_.clear();
+    }
+
+    void build(Vector<Stock>& stocks) {
+        clear();
+        int n = stocks.size();
+        allocate(n);
+        for (int i = 0; i < n; ++i) {
+            write_row(i, stocks[i]);
+        }
+        size_ = n;
+    }
+
+    void append_row(Stock& s) {
+        if (size_ >= capacity_) {
+            int new_capacity = capacity_ * 2;
+            if (new_capacity < 16) {
+                new_capacity = 16;
+            }
+            grow(new_capacity);
+        }
+        write_row(size_, s);
+        size_++;
+    }
+
+    void update_row(int row, Stock& s) {
+        if (row < 0 || row >= size_) {
+            throw "StockTable row out of range";
+        }
+        write_row(row, s);
+    }
+
+    int size() {
+        return size_;
+    }
+
+    double* column(int metric_id) {
+        if (metric_id < 0 || metric_id >= METRIC_COUNT) {
+            throw "Metric id out of range";
+        }
+        return columns_[metric_id];
+    }
+
+    int* years() {
+        return year_;
+    }
+
+    int* company_ids() {
+        return company_id_;
+    }
+
+    int* sector_ids() {
+        return sector_id_;
+    }
+
+    int company_count() {
+        return companies_.size();
+    }
+
+    int sector_count() {
+        return sectors_.size();
+    }
+
+    string& company_name(int company_id) {
+        return companies_.name(company_id);
+    }
+
+    string& sector_key(int sector_id) {
+        return sectors_.name(sector_id);
+    }
+
+    int find_company(string_view name) {
+        return companies_.find(name);
+    }
+
+    int find_sector(string_view sector) {
+        char buffer[KEY_BUFFER_SIZE];
+        int len = normalize_into(sector, buffer, KEY_BUFFER_SIZE);
+        if (len < 0) {
+            return sectors_.find(normalize_key(string(sector)));
+        }
+        return sectors_.find(string_view(buffer, len));
+    }
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#include "Vector.h"
+#include "FlatHashMap.h"
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+class SymbolTable {
+private:
+    Vector<string> names_;
+    FlatHashMap<string, int> ids_;
+
+public:
+    explicit SymbolTable() : names_(), ids_() {}
+
+    void clear() {
+        names_.clear();
+        ids_.clear();
+    }
+
+    void reserve(int count) {
+        names_.reserve(count + 1);
+        ids_.reserve(count);
+    }
+
+    int intern(string_view symbol) {
+        int* found = ids_.find(symbol);
+        if (found != nullptr) {
+            return *found;
+        }
+        int id = names_.size();
+        string owned(symbol);
+        names_.push_back(owned);
+        ids_.insert(owned, id);
+        return id;
+    }
+
+    int find(string_view symbol) {
+        int* found = ids_.find(symbol);
+        if (found == nullptr) {
+            return -1;
+        }
+        return *found;
+    }
+
+    string& name(int id) {
+        return names_[id];
+    }
+
+    int size() {
+        return names_.size();
+    }
+};
+
+#endif
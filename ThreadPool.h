@@ -0,0 +1,173 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+using namespace std;
+
+class ThreadPool {
+private:
+    std::thread* workers_;
+    int num_workers_;
+    std::mutex mutex_;
+    std::mutex submit_mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    void (*invoke_)(void*, int);
+    void* context_;
+    int tasks_;
+    int next_;
+    int pending_;
+    long long generation_;
+    bool stopping_;
+    std::exception_ptr error_;
+
+    static bool& inside_job() {
+        static thread_local bool inside = false;
+        return inside;
+    }
+
+    template<typename Fn>
+    static void call(void* context, int task) {
+        (*static_cast<Fn*>(context))(task);
+    }
+
+    void drain() {
+        while (true) {
+            void (*invoke)(void*, int);
+            void* context;
+            int task;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (next_ >= tasks_) {
+                    return;
+                }
+                task = next_++;
+                invoke = invoke_;
+                context = context_;
+            }
+            std::exception_ptr error;
+            try {
+                invoke(context, task);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (error) {
+                    if (!error_) {
+                        error_ = error;
+                    }
+                    pending_ -= tasks_ - next_;
+                    next_ = tasks_;
+                }
+                --pending_;
+                if (pending_ == 0) {
+                    done_.notify_all();
+                }
+            }
+        }
+    }
+
+    void worker_loop() {
+        inside_job() = true;
+        long long seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+                if (stopping_) {
+                    return;
+                }
+                seen = generation_;
+            }
+            drain();
+        }
+    }
+
+public:
+    explicit ThreadPool(int num_workers) : workers_(nullptr), num_workers_(num_workers < 0 ? 0 : num_workers),
+        invoke_(nullptr), context_(nullptr), tasks_(0), next_(0), pending_(0), generation_(0), stopping_(false), error_() {
+        if (num_workers_ > 0) {
+            workers_ = new std::thread[num_workers_];
+            for (int i = 0; i < num_workers_; ++i) {
+                workers_[i] = std::thread(&ThreadPool::worker_loop, this);
+            }
+        }
+    }
+
+    ThreadPool(const ThreadPool& other) = delete;
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (int i = 0; i < num_workers_; ++i) {
+            workers_[i].join();
+        }
+        delete[] workers_;
+    }
+
+    static ThreadPool& shared() {
+        static ThreadPool pool(hardware_threads() - 1);
+        return pool;
+    }
+
+    static int hardware_threads() {
+        unsigned int n = std::thread::hardware_concurrency();
+        if (n == 0) {
+            return 1;
+        }
+        return (int)n;
+    }
+
+    int size() const {
+        return num_workers_ + 1;
+    }
+
+    template<typename Fn>
+    void run(int tasks, Fn& fn) {
+        if (tasks <= 0) {
+            return;
+        }
+        if (tasks == 1 || num_workers_ == 0 || inside_job()) {
+            for (int t = 0; t < tasks; ++t) {
+                fn(t);
+            }
+            return;
+        }
+        std::lock_guard<std::mutex> submit(submit_mutex_);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            invoke_ = &ThreadPool::call<Fn>;
+            context_ = &fn;
+            tasks_ = tasks;
+            next_ = 0;
+            pending_ = tasks;
+            error_ = nullptr;
+            ++generation_;
+        }
+        wake_.notify_all();
+        inside_job() = true;
+        drain();
+        inside_job() = false;
+        std::exception_ptr error;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_.wait(lock, [&] { return pending_ == 0; });
+            error = error_;
+            error_ = nullptr;
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef VECTOR_H
 #define VECTOR_H
 
+#include <utility>
+
 using namespace std;
 
 template<typename T>
@@ -78,6 +80,19 @@ public:
         data[size_++] = value;
     }
 
+    void push_back(T&& value) {
+        if (size_ >= capacity_) {
+            resize(capacity_ * 2);
+        }
+        data[size_++] = std::move(value);
+    }
+
+    void reserve(int new_capacity) {
+        if (new_capacity > capacity_) {
+            resize(new_capacity);
+        }
+    }
+
     void pop_back() {
         if (size_ > 0) {
             --size_;
@@ -103,6 +118,10 @@ public:
         return size_;
     }
 
+    int capacity() {
+        return capacity_;
+    }
+
     bool empty() {
         return size_ == 0;
     }
@@ -97,54 +97,14 @@ Vector<Stock*> all_ptrs(DataStore& store) {
 }
 
 Vector<Stock*> unique_latest_companies(DataStore& store) {
-    Vector<Stock*> result;
-    for (int i = 0; i < store.all_stocks.size(); ++i) {
-        Stock* s = &store.all_stocks[i];
-        bool found = false;
-        for (int j = 0; j < result.size(); ++j) {
-            if (result[j]->company_name == s->company_name) {
-                if (s->year > result[j]->year) {
-                    result[j] = s;
-                }
-                found = true;
-                break;
-            }
-        }
-        if (!found) {
-            result.push_back(s);
-        }
-    }
-    return result;
+    return store.latest_per_company();
 }
 
 int pick_company_index(DataStore& store, const string& title);
 
-void collect_company_history(DataStore& store, int base_index, Vector<Stock*>& series) {
-    series.clear();
-    if (base_index < 0 || base_index >= store.all_stocks.size()) {
-        return;
-    }
-    string name = store.all_stocks[base_index].company_name;
-    for (int i = 0; i < store.all_stocks.size(); ++i) {
-        if (store.all_stocks[i].company_name == name) {
-            series.push_back(&store.all_stocks[i]);
-        }
-    }
-    int n = series.size();
-    for (int i = 0; i < n - 1; ++i) {
-        for (int j = i + 1; j < n; ++j) {
-            if (series[j]->year < series[i]->year) {
-                Stock* tmp = series[i];
-                series[i] = series[j];
-                series[j] = tmp;
-            }
-        }
-    }
-}
-
 void export_company_history_to_csv(DataStore& store, int base_index, int predicted_year, double predicted_price, const string& file_path) {
     Vector<Stock*> history;
-    collect_company_history(store, base_index, history);
+    store.company_history(base_index, history);
     std::ofstream out(file_path.c_str());
     if (!out.is_open()) {
         return;
@@ -344,114 +304,30 @@ void show_advanced_company_analysis(DataStore& store) {
     if (idx < 0) {
         return;
     }
-    Vector<Stock*> history;
-    collect_company_history(store, idx, history);
-    if (history.size() == 0) {
+    DataStore::CompanyPerformance perf = store.company_performance(idx);
+    if (perf.points == 0) {
         cout << COLOR_WARN << "No history available for this company." << COLOR_RESET << endl;
         cout << "\nPress any key to continue...";
         _getch();
         return;
     }
 
-    Stock* latest = history[history.size() - 1];
+    Stock* latest = &store.all_stocks[perf.latest_row];
     string trend = store.trend_flag(latest);
 
-    double first_price = history[0]->price;
-    double last_price = latest->price;
-    int first_year = history[0]->year;
-    int last_year = latest->year;
-    int years_span = last_year - first_year;
-
-    double cagr = 0.0;
-    if (years_span > 0 && first_price > 0.0 && last_price > 0.0) {
-        double ratio = last_price / first_price;
-        double step = 1.0 / (double)years_span;
-        double val = 1.0;
-        double low = 0.0;
-        double high = ratio;
-        for (int it = 0; it < 40; ++it) {
-            double mid = (low + high) * 0.5;
-            double pow_val = 1.0;
-            for (int k = 0; k < years_span; ++k) {
-                pow_val = pow_val * (1.0 + mid);
-            }
-            if (pow_val > ratio) {
-                high = mid;
-            } else {
-                low = mid;
-            }
-        }
-        cagr = (low + high) * 0.5;
-    }
-
-    int ret_count = history.size() - 1;
-    double sum_ret = 0.0;
-    double sum_ret_sq = 0.0;
-    double min_ret = 0.0;
-    double max_ret = 0.0;
-    if (ret_count > 0) {
-        for (int i = 0; i < ret_count; ++i) {
-            double p0 = history[i]->price;
-            double p1 = history[i + 1]->price;
-            if (p0 <= 0.0) {
-                continue;
-            }
-            double r = (p1 - p0) / p0;
-            sum_ret = sum_ret + r;
-            sum_ret_sq = sum_ret_sq + r * r;
-            if (i == 0 || r < min_ret) {
-                min_ret = r;
-            }
-            if (i == 0 || r > max_ret) {
-                max_ret = r;
-            }
-        }
-    }
-
-    double avg_ret = 0.0;
-    double vol_ret = 0.0;
-    if (ret_count > 0) {
-        avg_ret = sum_ret / (double)ret_count;
-        double mean_sq = sum_ret_sq / (double)ret_count;
-        double sq_mean = avg_ret * avg_ret;
-        double var = mean_sq - sq_mean;
-        if (var < 0.0) {
-            var = 0.0;
-        }
-        double x = var;
-        double g = x;
-        double eps = 0.000001;
-        if (x > 0.0) {
-            double guess = x;
-            for (int it = 0; it < 30; ++it) {
-                guess = 0.5 * (guess + x / guess);
-            }
-            g = guess;
-        } else {
-            g = 0.0;
-        }
-        vol_ret = g;
-    }
-
-    double sum_div_yield = 0.0;
-    for (int i = 0; i < history.size(); ++i) {
-        sum_div_yield = sum_div_yield + history[i]->dividend_yield;
-    }
-    double avg_div_yield = sum_div_yield / (double)history.size();
-
     render_header();
     cout << COLOR_DIM << "Advanced Company Analysis" << COLOR_RESET << endl << endl;
     cout << "Company: " << COLOR_HIGHLIGHT << latest->company_name << COLOR_RESET << endl;
     cout << "Sector : " << latest->sector << endl;
-    cout << "Years  : " << first_year << " - " << last_year << " (" << history.size() << " points)" << endl;
+    cout << "Years  : " << perf.first_year << " - " << perf.last_year << " (" << perf.points << " points)" << endl;
     cout << "Trend  : " << trend << endl << endl;
 
-    cout << "Price first / last : " << first_price << " -> " << last_price << endl;
-    cout << "CAGR (approx)      : " << cagr * 100.0 << "% per year" << endl;
-    cout << "Avg YoY return     : " << avg_ret * 100.0 << "% per year" << endl;
-    cout << "Volatility (stddev): " << vol_ret * 100.0 << "% per year" << endl;
-    cout << "Best / worst year  : " << max_ret * 100.0 << "% / " << min_ret * 100.0 << "%\n";
-    cout << "Avg dividend yield : " << avg_div_yield << "%\n";
+    cout << "Price first / last : " << perf.first_price << " -> " << perf.last_price << endl;
+    cout << "CAGR (approx)      : " << perf.cagr * 100.0 << "% per year" << endl;
+    cout << "Avg YoY return     : " << perf.avg_return * 100.0 << "% per year" << endl;
+    cout << "Volatility (stddev): " << perf.volatility * 100.0 << "% per year" << endl;
+    cout << "Best / worst year  : " << perf.best_return * 100.0 << "% / " << perf.worst_return * 100.0 << "%\n";
+    cout << "Avg dividend yield : " << perf.avg_div_yield << "%\n";
 
     cout << "\nPress any key to continue...";
     _getch();
@@ -531,18 +407,17 @@ int pick_option(Vector<string>& items, const string& title) {
 bool pick_sector(DataStore& store, string& out_sector, const string& title) {
     Vector<Stock*> companies = unique_latest_companies(store);
     Vector<string> sectors;
+    Vector<bool> seen(store.table.sector_count() + 1);
+    for (int i = 0; i < store.table.sector_count(); ++i) {
+        seen.push_back(false);
+    }
     for (int i = 0; i < companies.size(); ++i) {
-        string sec = companies[i]->sector;
-        bool exists = false;
-        for (int j = 0; j < sectors.size(); ++j) {
-            if (sectors[j] == sec) {
-                exists = true;
-                break;
-            }
-        }
-        if (!exists) {
-            sectors.push_back(sec);
+        int sector_id = companies[i]->sector_id;
+        if (sector_id == NO_SECTOR || seen[sector_id]) {
+            continue;
         }
+        seen[sector_id] = true;
+        sectors.push_back(companies[i]->sector);
     }
     if (sectors.size() == 0) {
         cout << COLOR_WARN << "No sectors available. Please load CSV first." << COLOR_RESET << endl;
@@ -1731,23 +1606,7 @@ int main() {
                         break;
                     }
                     Vector<Stock*> raw = store.filter_by_sector(sec);
-                    Vector<Stock*> v;
-                    for (int i = 0; i < raw.size(); ++i) {
-                        Stock* s = raw[i];
-                        bool found = false;
-                        for (int j = 0; j < v.size(); ++j) {
-                            if (v[j]->company_name == s->company_name) {
-                                if (s->year > v[j]->year) {
-                                    v[j] = s;
-                                }
-                                found = true;
-                                break;
-                            }
-                        }
-                        if (!found) {
-                            v.push_back(s);
-                        }
-                    }
+                    Vector<Stock*> v = store.latest_by_company(raw);
                     cout << "\nFound " << v.size() << " companies in sector: " << sec << endl;
                     if (v.size() > 0) {
                         list_stocks(v, 10);
@@ -1878,34 +1737,9 @@ int main() {
                     } else if (n_choice == 3) {
                         n = 50;
                     }
-                    Vector<Stock*> recs = store.recommend(strategy_id, store.all_stocks.size());
-                    Vector<Stock*> unique_recs;
-                    for (int i = 0; i < recs.size(); ++i) {
-                        Stock* s = recs[i];
-                        bool found = false;
-                        for (int j = 0; j < unique_recs.size(); ++j) {
-                            if (unique_recs[j]->company_name == s->company_name) {
-                                if (s->year > unique_recs[j]->year) {
-                                    unique_recs[j] = s;
-                                }
-                                found = true;
-                                break;
-                            }
-                        }
-                        if (!found) {
-                            unique_recs.push_back(s);
-                        }
-                    }
-                    int available = unique_recs.size();
-                    int show_n = n;
-                    if (available < show_n) {
-                        show_n = available;
-                    }
-                    cout << "\nFound " << available << " recommended companies, showing top " << show_n << ":\n";
-                    Vector<Stock*> top_list;
-                    for (int i = 0; i < show_n; ++i) {
-                        top_list.push_back(unique_recs[i]);
-                    }
+                    Vector<Stock*> top_list = store.recommend(strategy_id, n, true);
+                    int show_n = top_list.size();
+                    cout << "\nShowing top " << show_n << " recommended companies:\n";
                     string title = "Top " + std::to_string(show_n) + " Recommendations";
                     browse_sorted_list(top_list, title);
                     break;